@@ -1,32 +1,44 @@
 #version 450
 
+#ifdef STEREO
+#define sampler_layers sampler2DArray
+#define layer_uv(uv) vec3(uv, inp.layer)
+#else
+#define sampler_layers sampler2D
+#define layer_uv(uv) (uv)
+#endif
+
 layout (location = 0) out vec4 col;
-layout (binding = 0) uniform sampler2D tex_col;
-layout (binding = 1) uniform sampler2D tex_vel;
+layout (binding = 0) uniform sampler_layers tex_col;
+layout (binding = 1) uniform sampler_layers tex_vel;
 
 layout (location = 0) uniform float vel_scale;
+layout (location = 1) uniform vec4 view_rect;
 
 in in_block
 {
 	vec2 texcoord;
+	flat int layer;
 } inp;
 
 void main()
 {
-    vec2 texel_size = 1.0 / vec2(textureSize(tex_col, 0));
+    vec2 texel_size = 1.0 / vec2(textureSize(tex_col, 0).xy);
     vec2 tex_coords = gl_FragCoord.xy * texel_size;
-    vec2 vel = texture(tex_vel, tex_coords).rg;
-    vel *= vel_scale;
+    vec2 vel = texture(tex_vel, layer_uv(tex_coords)).rg;
+    vel *= vel_scale * (view_rect.zw - view_rect.xy);
+    vec2 lo = view_rect.xy + 0.5 * texel_size;
+    vec2 hi = view_rect.zw - 0.5 * texel_size;
 
     float speed = length(vel / texel_size);
     int samples = clamp(int(speed), 1, 40);
 
-    col = texture(tex_col, inp.texcoord);
+    col = texture(tex_col, layer_uv(inp.texcoord));
 
     for (int i = 1; i < samples; ++i)
     {
         vec2 offset = vel * (float(i) / float(samples - 1) - 0.5);
-        col += texture(tex_col, tex_coords + offset);
+        col += texture(tex_col, layer_uv(clamp(tex_coords + offset, lo, hi)));
     }
     col /= float(samples);
 }
\ No newline at end of file
@@ -1,12 +1,18 @@
 #version 450
 
+#ifdef STEREO
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
 out gl_PerVertex{ vec4 gl_Position; };
 
 layout(location = 3) uniform vec2 u_uv_diff;
+layout(location = 5) uniform vec2 u_uv_offset;
 
 out out_block
 {
 	vec2 texcoord;
+	flat int layer;
 } o;
 
 void main()
@@ -29,6 +35,10 @@ void main()
 	const vec2 position = v[i[gl_VertexID]];
 	const vec2 texcoord = t[i[gl_VertexID]];
 
-	o.texcoord = texcoord * u_uv_diff;
+	o.texcoord = u_uv_offset + texcoord * u_uv_diff;
+	o.layer = gl_InstanceID;
 	gl_Position = vec4(position, 0.0, 1.0);
+#ifdef STEREO
+	gl_Layer = gl_InstanceID;
+#endif
 }
\ No newline at end of file
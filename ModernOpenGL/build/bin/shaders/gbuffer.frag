@@ -7,19 +7,90 @@ in in_block
 	vec2 uvs;
 	smooth vec4 curr_pos;
 	smooth vec4 prev_pos;
+	flat uint id;
 } i;
 
 layout (location = 0) out vec3 out_pos;
 layout (location = 1) out vec3 out_nrm;
 layout (location = 2) out vec4 out_alb;
 layout (location = 3) out vec2 out_vel;
+layout (location = 4) out uint out_id;
 
 layout (binding = 0) uniform sampler2D dif;
 layout (binding = 1) uniform sampler2D spc;
 layout (binding = 2) uniform sampler2D nrm;
 
+/* mip feedback, on the frames the streamer asks for: the finest level of the full chain each
+   material texture was sampled at, atomic min per texture, from one pixel in sixteen */
+layout (std430, binding = 2) buffer feedback_block
+{
+	uint feedback_levels[3];
+};
+layout (location = 0) uniform bool u_feedback;
+layout (location = 1) uniform vec2 u_feedback_sizes[3];
+
+/* derivatives have to be taken in uniform control flow, so this runs before any branch */
+void write_feedback()
+{
+	const vec2 dx = dFdx(i.uvs);
+	const vec2 dy = dFdy(i.uvs);
+	if (!u_feedback || gl_HelperInvocation || any(notEqual(ivec2(gl_FragCoord.xy) & 3, ivec2(0))))
+		return;
+
+	for (int t = 0; t < 3; t++)
+	{
+		const float lod = 0.5 * log2(max(dot(dx * u_feedback_sizes[t], dx * u_feedback_sizes[t]), dot(dy * u_feedback_sizes[t], dy * u_feedback_sizes[t])));
+		atomicMin(feedback_levels[t], uint(max(floor(lod), 0.0)));
+	}
+}
+
+#ifdef OVERDRAW
+layout (early_fragment_tests) in;
+layout (binding = 0, r32ui) uniform coherent uimage2D overdraw_fragments;
+layout (binding = 1, r32ui) uniform coherent uimage2D overdraw_helpers;
+
+/* counts this fragment, and once per 2x2 quad the helper lanes that ran alongside it.
+   coverage of the other quad lanes comes from fine derivatives, so this has to run in uniform control flow */
+void count_overdraw()
+{
+	const float covered = gl_HelperInvocation ? 0.0 : 1.0;
+	const ivec2 parity = ivec2(gl_FragCoord.xy) & 1;
+	const float sx = parity.x == 0 ? 1.0 : -1.0;
+	const float sy = parity.y == 0 ? 1.0 : -1.0;
+
+	const float horizontal = covered + sx * dFdxFine(covered);
+	const float vertical = covered + sy * dFdyFine(covered);
+	const float diagonal = horizontal + sy * dFdyFine(horizontal);
+
+	float quad[4];
+	quad[parity.y * 2 + parity.x] = covered;
+	quad[parity.y * 2 + (1 - parity.x)] = horizontal;
+	quad[(1 - parity.y) * 2 + parity.x] = vertical;
+	quad[(1 - parity.y) * 2 + (1 - parity.x)] = diagonal;
+
+	int leader = 0;
+	while (leader < 3 && quad[leader] < 0.5)
+		leader++;
+
+	if (gl_HelperInvocation)
+		return;
+
+	const ivec2 pixel = ivec2(gl_FragCoord.xy);
+	imageAtomicAdd(overdraw_fragments, pixel, 1u);
+	if (leader == parity.y * 2 + parity.x)
+	{
+		const float lanes = round(quad[0] + quad[1] + quad[2] + quad[3]);
+		imageAtomicAdd(overdraw_helpers, pixel, uint(4.0 - lanes));
+	}
+}
+#endif
+
 void main()
 {
+#ifdef OVERDRAW
+	count_overdraw();
+#endif
+	write_feedback();
 	vec3 dif_tex = texture(dif, i.uvs).rgb;
 	vec3 spc_tex = texture(spc, i.uvs).rgb;
 	vec3 nrm_tex = texture(nrm, i.uvs).rgb;
@@ -29,4 +100,5 @@ void main()
 	out_alb.rgb = texture(dif, i.uvs).rgb;
 	out_alb.a = texture(spc, i.uvs).r;
 	out_vel = ((i.curr_pos.xy / i.curr_pos.w) * 0.5 + 0.5) - ((i.prev_pos.xy / i.prev_pos.w) * 0.5 + 0.5);
+	out_id = i.id;
 }
\ No newline at end of file
@@ -1,5 +1,12 @@
 #version 450
 
+#ifdef STEREO
+#extension GL_ARB_shader_viewport_layer_array : require
+#define LAYERS 2
+#else
+#define LAYERS 1
+#endif
+
 out gl_PerVertex { vec4 gl_Position; };
 
 out out_block
@@ -9,6 +16,7 @@ out out_block
 	vec2 uvs;
 	smooth vec4 curr_pos;
 	smooth vec4 prev_pos;
+	flat uint id;
 } o;
 
 layout (location = 0) in vec3 pos;
@@ -16,28 +24,54 @@ layout (location = 1) in vec3 col;
 layout (location = 2) in vec3 nrm;
 layout (location = 3) in vec2 uvs;
 
-layout (location = 0) uniform mat4 proj;
-layout (location = 1) uniform mat4 view;
-layout (location = 2) uniform mat4 modl;
-layout (location = 3) uniform mat4 mvp_curr;
-layout (location = 4) uniform mat4 mvp_prev;
-layout (location = 5) uniform bool except;
+struct object_t
+{
+	mat4 modl;
+	mat4 modl_prev;
+	uint id;
+	uint except;
+};
+
+struct view_t
+{
+	mat4 proj;
+	mat4 view;
+	mat4 view_proj_prev;
+};
+
+layout (std140, binding = 0) uniform view_block
+{
+	view_t views[LAYERS];
+};
+
+layout (std430, binding = 0) readonly buffer object_block
+{
+	object_t objects[];
+};
+
+layout (location = 0) uniform uint object_index;
 
 void main()
 {
-	if (!except)
+	const object_t object = objects[object_index];
+	const view_t v = views[gl_InstanceID];
+	const vec4 mpos = (v.view * object.modl * vec4(pos, 1.0));
+
+	o.curr_pos = v.proj * mpos;
+	if (object.except == 0)
 	{
-		o.curr_pos = mvp_curr * vec4(pos, 1.0);
-		o.prev_pos = mvp_prev * vec4(pos, 1.0);
+		o.prev_pos = v.view_proj_prev * object.modl_prev * vec4(pos, 1.0);
 	}
 	else
 	{
-		o.curr_pos = mvp_curr * vec4(pos, 1.0);
 		o.prev_pos = o.curr_pos;
 	}
-	const vec4 mpos = (view * modl * vec4(pos, 1.0));
-	o.pos = (modl * vec4(pos, 1.0)).xyz;
-	o.nrm = mat3(transpose(inverse(modl))) * nrm;
+	o.pos = (object.modl * vec4(pos, 1.0)).xyz;
+	o.nrm = mat3(transpose(inverse(object.modl))) * nrm;
 	o.uvs = uvs;
-	gl_Position = proj * mpos;
+	o.id = object.id;
+	gl_Position = v.proj * mpos;
+#ifdef STEREO
+	gl_Layer = gl_InstanceID;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 450
+
+layout (location = 0) out vec4 col;
+layout (binding = 0) uniform sampler2D tex_font;
+
+in in_block
+{
+	vec2 texcoord;
+	flat uint glyph;
+	flat vec4 color;
+} inp;
+
+const uint solid = 255u;
+const uint columns = 16u;
+const ivec2 cell = ivec2(8, 10);
+
+void main()
+{
+	float coverage = 1.0;
+	if (inp.glyph != solid)
+	{
+		const ivec2 origin = ivec2(inp.glyph % columns, inp.glyph / columns) * cell;
+		const ivec2 texel = min(ivec2(inp.texcoord * vec2(cell)), cell - 1);
+		coverage = texelFetch(tex_font, origin + texel, 0).r;
+	}
+	col = vec4(inp.color.rgb, inp.color.a * coverage);
+}
\ No newline at end of file
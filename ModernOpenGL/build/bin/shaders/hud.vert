@@ -0,0 +1,47 @@
+#version 450
+
+out gl_PerVertex{ vec4 gl_Position; };
+
+struct glyph_t
+{
+	uint position;
+	uint size;
+	uint glyph;
+	uint color;
+};
+
+layout(std430, binding = 0) readonly buffer glyph_block
+{
+	glyph_t glyphs[];
+};
+
+layout(location = 0) uniform vec2 u_viewport;
+
+out out_block
+{
+	vec2 texcoord;
+	flat uint glyph;
+	flat vec4 color;
+} o;
+
+void main()
+{
+	/* counter clockwise once y points down the screen */
+	vec2 corners[] = {
+		vec2(0.0f, 0.0f),
+		vec2(0.0f, 1.0f),
+		vec2(1.0f, 1.0f),
+		vec2(0.0f, 0.0f),
+		vec2(1.0f, 1.0f),
+		vec2(1.0f, 0.0f)
+	};
+
+	const glyph_t g = glyphs[gl_InstanceID];
+	const vec2 corner = corners[gl_VertexID];
+	const vec2 position = vec2(g.position & 0xffffu, g.position >> 16) + corner * vec2(g.size & 0xffffu, g.size >> 16);
+
+	o.texcoord = corner;
+	o.glyph = g.glyph;
+	o.color = unpackUnorm4x8(g.color);
+	gl_Position = vec4(position / u_viewport * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+}
\ No newline at end of file
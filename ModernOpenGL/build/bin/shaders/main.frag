@@ -1,18 +1,31 @@
 #version 450
 
+#ifdef STEREO
+#define sampler_layers sampler2DArray
+#define layer_uv(uv) vec3(uv, i.layer)
+#else
+#define sampler_layers sampler2D
+#define layer_uv(uv) (uv)
+#endif
+
 layout (location = 0) out vec4 col;
-layout (binding = 0) uniform sampler2D tex_position;
-layout (binding = 1) uniform sampler2D tex_normal;
-layout (binding = 2) uniform sampler2D tex_albedo;
-layout (binding = 3) uniform sampler2D tex_depth;
+layout (binding = 0) uniform sampler_layers tex_position;
+layout (binding = 1) uniform sampler_layers tex_normal;
+layout (binding = 2) uniform sampler_layers tex_albedo;
+layout (binding = 3) uniform sampler_layers tex_depth;
 layout (binding = 4) uniform samplerCube texcube_skybox;
+layout (binding = 5) uniform samplerCube texcube_skybox_previous;
 
 layout (location = 0) uniform vec3 u_camera_position;
+/* 1 once a sky switch has faded in */
+layout (location = 1) uniform float u_sky_fade;
 
 in in_block
 {
 	vec2 texcoord;
 	vec3 ray;
+	flat vec3 eye;
+	flat int layer;
 } i;
 
 vec3 calculate_specular(float strength, vec3 color, vec3 view_pos, vec3 vert_pos, vec3 light_dir, vec3 normal)
@@ -26,12 +39,17 @@ vec3 calculate_specular(float strength, vec3 color, vec3 view_pos, vec3 vert_pos
 
 void main()
 {
-	const vec3 position = texture(tex_position, i.texcoord).rgb;
-	const vec3 normal = texture(tex_normal, i.texcoord).rgb;
-	const vec4 albedo_specular = texture(tex_albedo, i.texcoord);
+	const vec3 position = texture(tex_position, layer_uv(i.texcoord)).rgb;
+	const vec3 normal = texture(tex_normal, layer_uv(i.texcoord)).rgb;
+	const vec4 albedo_specular = texture(tex_albedo, layer_uv(i.texcoord));
 	const vec3 albedo = albedo_specular.rgb;
 	const float specular = albedo_specular.a;
-	const float depth = texture(tex_depth, i.texcoord).r;
+	const float depth = texture(tex_depth, layer_uv(i.texcoord)).r;
+#ifdef STEREO
+	const vec3 camera_position = i.eye;
+#else
+	const vec3 camera_position = u_camera_position;
+#endif
 	
 	vec4 final_color = vec4(1.0);
 	vec3 ambient_col = vec3(0.2);
@@ -41,12 +59,14 @@ void main()
 	vec3 light_dir = normalize(light_pos - position);
 	float light_dif = max(dot(normal, light_dir), 0.0);
 		
-	vec3 light_spec = calculate_specular(specular, light_col, u_camera_position, position, light_dir, normal);
+	vec3 light_spec = calculate_specular(specular, light_col, camera_position, position, light_dir, normal);
 
 	final_color.xyz = (ambient_col + (light_dif * light_col) + light_spec) * albedo;
 	if (depth == 1.0)
 	{
 		col = texture(texcube_skybox, i.ray);
+		if (u_sky_fade < 1.0)
+			col = mix(texture(texcube_skybox_previous, i.ray), col, u_sky_fade);
 	}
 	else
 	{
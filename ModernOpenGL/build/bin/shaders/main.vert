@@ -1,18 +1,41 @@
 #version 450
 
+#ifdef STEREO
+#extension GL_ARB_shader_viewport_layer_array : require
+#define LAYERS 2
+#else
+#define LAYERS 1
+#endif
+
 out gl_PerVertex{ vec4 gl_Position; };
 
 layout(location = 0) uniform mat3 u_camera_direction;
 layout(location = 1) uniform float u_fov;
 layout(location = 2) uniform float u_ratio;
 layout(location = 3) uniform vec2 u_uv_diff;
+layout(location = 4) uniform vec4 u_tile;
+layout(location = 5) uniform vec2 u_uv_offset;
 
 out out_block
 {
 	vec2 texcoord;
 	vec3 ray;
+	flat vec3 eye;
+	flat int layer;
 } o;
 
+struct view_t
+{
+	mat4 proj;
+	mat4 view;
+	mat4 view_proj_prev;
+};
+
+layout (std140, binding = 0) uniform view_block
+{
+	view_t views[LAYERS];
+};
+
 vec3 skyray(vec2 texcoord, float fovy, float aspect)
 {
 	float d = 0.5 / tan(fovy / 2.0);
@@ -39,7 +62,18 @@ void main()
 	const vec2 position = v[i[gl_VertexID]];
 	const vec2 texcoord = t[i[gl_VertexID]];
 
-	o.ray = u_camera_direction * skyray(texcoord, u_fov, u_ratio);
-	o.texcoord = texcoord * u_uv_diff;
+#ifdef STEREO
+	const view_t v = views[gl_InstanceID];
+	const mat3 eye_to_world = transpose(mat3(v.view));
+	const vec4 ray = inverse(v.proj) * vec4(texcoord * 2.0 - 1.0, 1.0, 1.0);
+	o.ray = eye_to_world * normalize(ray.xyz / ray.w);
+	o.eye = -(eye_to_world * v.view[3].xyz);
+	gl_Layer = gl_InstanceID;
+#else
+	o.ray = u_camera_direction * skyray(u_tile.xy + texcoord * u_tile.zw, u_fov, u_ratio);
+	o.eye = vec3(0.0);
+#endif
+	o.layer = gl_InstanceID;
+	o.texcoord = u_uv_offset + texcoord * u_uv_diff;
 	gl_Position = vec4(position, 0.0, 1.0);
 }
\ No newline at end of file
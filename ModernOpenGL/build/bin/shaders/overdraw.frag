@@ -0,0 +1,30 @@
+#version 450
+
+layout (location = 0) out vec4 col;
+layout (binding = 0) uniform usampler2D tex_fragments;
+
+layout (location = 0) uniform uint max_fragments;
+
+in in_block
+{
+	vec2 texcoord;
+	flat int layer;
+} inp;
+
+vec3 heat(float t)
+{
+	return clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+}
+
+void main()
+{
+	const uint count = texelFetch(tex_fragments, ivec2(gl_FragCoord.xy), 0).r;
+	if (count == 0)
+	{
+		col = vec4(0.0);
+	}
+	else
+	{
+		col = vec4(heat(float(count - 1) / float(max(max_fragments - 1u, 1u))), 1.0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <string_view>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <array>
+#include <stdexcept>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <stb_image.h>
+#include <glm/glm.hpp>
+
+#include "scene.hpp"
+
+/* micro benchmarks of the cpu hot paths. run from the directory holding shaders/ and textures/, like the demo:
+	bench [filter] [--samples n] [--sample-ms ms] [--warmup-ms ms] [--cpu n] */
+
+struct bench_options_t
+{
+	std::string filter;
+	int samples = 30;
+	double sample_ms = 10.0;
+	double warmup_ms = 200.0;
+	int cpu = -1;
+};
+
+/* keeps the compiler from dropping a result nobody reads */
+template<typename T>
+inline void keep(T const& value)
+{
+#ifdef __GNUC__
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	static void const* volatile sink;
+	sink = &value;
+#endif
+}
+
+template<typename F>
+double time_batch(size_t batch, F& op)
+{
+	auto const start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < batch; i++)
+		op();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* warms up while doubling the batch until one batch lasts sample_ms, then times samples batches.
+   bytes_per_op adds a throughput column for kernels that stream through memory */
+template<typename F>
+void run_bench(bench_options_t const& options, std::string_view name, size_t bytes_per_op, F op)
+{
+	if (!options.filter.empty() && name.find(options.filter) == std::string_view::npos)
+		return;
+
+	auto batch = size_t(1);
+	auto warmup = 0.0;
+	while (warmup < options.warmup_ms)
+	{
+		auto const ms = time_batch(batch, op);
+		warmup += ms;
+		if (ms < options.sample_ms)
+			batch *= 2;
+	}
+
+	std::vector<double> ns_per_op(size_t(options.samples));
+	for (auto& sample : ns_per_op)
+		sample = time_batch(batch, op) * 1e6 / double(batch);
+
+	auto const mean = std::accumulate(ns_per_op.begin(), ns_per_op.end(), 0.0) / double(ns_per_op.size());
+	auto variance = 0.0;
+	for (auto const sample : ns_per_op)
+		variance += (sample - mean) * (sample - mean);
+	variance /= double(std::max<size_t>(ns_per_op.size() - 1, 1));
+	auto const fastest = *std::min_element(ns_per_op.begin(), ns_per_op.end());
+
+	std::printf("%-24s %14.1f ns/op %7.2f%% cv %14.1f min %14.0f op/s", std::string(name).c_str(), mean, 100.0 * std::sqrt(variance) / mean, fastest, 1e9 / mean);
+	if (bytes_per_op)
+		std::printf(" %10.1f MB/s", double(bytes_per_op) / mean * 1e3);
+	std::printf("\n");
+	std::fflush(stdout);
+}
+
+bench_options_t parse_options(int argc, char* argv[])
+{
+	bench_options_t options;
+	for (auto i = 1; i < argc; i++)
+	{
+		std::string_view const arg = argv[i];
+		auto const value = [&]() -> std::string {
+			if (i + 1 >= argc)
+				throw std::runtime_error("missing value for " + std::string(arg));
+			return argv[++i];
+		};
+
+		if (arg == "--samples")				options.samples = std::max(std::stoi(value()), 2);
+		else if (arg == "--sample-ms")		options.sample_ms = std::stod(value());
+		else if (arg == "--warmup-ms")		options.warmup_ms = std::stod(value());
+		else if (arg == "--cpu")			options.cpu = std::stoi(value());
+		else if (arg.substr(0, 2) == "--")	throw std::runtime_error("unknown option " + std::string(arg));
+		else								options.filter = std::string(arg);
+	}
+	return options;
+}
+
+/* pins to one cpu so migrations and frequency differences between cores stay out of the numbers */
+void pin_thread(int cpu)
+{
+#ifdef __linux__
+	if (cpu < 0)
+		cpu = sched_getcpu();
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		std::clog << "failed to pin to cpu " << cpu << '\n';
+	else
+		std::clog << "pinned to cpu " << cpu << '\n';
+#else
+	(void)cpu;
+	std::clog << "cpu pinning is only implemented on linux\n";
+#endif
+}
+
+/* a scene as big as one frame may draw, scattered around the cameras of the demo scene */
+std::vector<scene_object_t> create_bench_objects(size_t count)
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+	std::vector<scene_object_t> objects;
+	for (size_t i = 0; i < count; i++)
+	{
+		objects.emplace_back(i % 8 == 0 ? shape_t::quad : shape_t::cube);
+		objects.back().model = glm::translate(glm::vec3(position(random), position(random), position(random))) * glm::rotate(angle(random), glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+	return objects;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		auto const options = parse_options(argc, argv);
+		pin_thread(options.cpu);
+
+		/* transforms */
+		auto angle = 0.0f;
+		run_bench(options, "orbit_axis", 0, [&angle]() {
+			angle += 0.01f;
+			keep(orbit_axis(angle, glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 2.0f, 0.0f)));
+		});
+
+		auto scene = create_scene();
+		run_bench(options, "update_scene", 0, [&scene]() {
+			update_scene(scene, true);
+			keep(scene.objects);
+		});
+
+		run_bench(options, "scene_command", 0, [&scene]() {
+			keep(apply_scene_command(scene, "rotate 0.001 0.002"));
+		});
+
+		/* culling and draw list, four split-screen views over a full object buffer */
+		std::array<frustum_t, 4> frustums;
+		for (size_t v = 0; v < frustums.size(); v++)
+		{
+			frustums[v] = extract_frustum(glm::perspective(scene.cameras[v].fov, 16.0f / 9.0f, 0.1f, 1000.0f) * camera_view(scene.cameras[v]));
+		}
+		run_bench(options, "extract_frustum", 0, [&scene]() {
+			keep(extract_frustum(glm::perspective(scene.cameras[0].fov, 16.0f / 9.0f, 0.1f, 1000.0f) * camera_view(scene.cameras[0])));
+		});
+
+		auto const objects = create_bench_objects(1024);
+		std::vector<draw_t> draws;
+		draws.reserve(objects.size());
+		run_bench(options, "cull_objects_1024x4", 0, [&]() {
+			cull_objects(objects, frustums.data(), frustums.size(), draws);
+			keep(draws);
+		});
+
+		/* sort key generation and the sort alone, from a shuffled list */
+		std::vector<draw_t> shuffled(objects.size());
+		for (size_t i = 0; i < objects.size(); i++)
+			shuffled[i] = { 0, uint32_t(i), 1 };
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+		run_bench(options, "sort_draws_1024", 0, [&]() {
+			draws = shuffled;
+			for (auto& draw : draws)
+				draw.key = (uint64_t(objects[draw.object].shape) << 32) | uint64_t(draw.object);
+			std::sort(draws.begin(), draws.end(), [](draw_t const& a, draw_t const& b) { return a.key < b.key; });
+			keep(draws);
+		});
+
+		/* stats formatting */
+		counters_t counters;
+		for (size_t i = 0; i < counter_count; i++)
+			counters[i] = 1000 * (i + 1);
+		run_bench(options, "format_frame_stats", 0, [&counters]() {
+			keep(format_frame_stats(0.016, counters));
+		});
+
+		/* files and images */
+		auto const shader = read_text_file("./shaders/main.frag");
+		run_bench(options, "read_text_file", shader.size(), []() {
+			keep(read_text_file("./shaders/main.frag"));
+		});
+
+		int width = 0, height = 0, channels = 0;
+		auto const image = stbi_load("./textures/T_Default_D.png", &width, &height, &channels, STBI_rgb);
+		if (!image)
+			throw std::runtime_error("failed to load ./textures/T_Default_D.png");
+		auto const image_size = size_t(width) * size_t(height) * 3;
+		run_bench(options, "stbi_load", image_size, []() {
+			int x, y, c;
+			auto const data = stbi_load("./textures/T_Default_D.png", &x, &y, &c, STBI_rgb);
+			keep(data);
+			stbi_image_free(data);
+		});
+
+		run_bench(options, "generate_mips", image_size, [&]() {
+			keep(generate_mips(image, width, height, 3));
+		});
+		stbi_image_free(image);
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,297 @@
+#pragma once
+
+/* the cpu side of the demo that needs no gl context: files, formatting, the scene and its
+   simulation, culling and image processing. shared by the demo and the benchmark */
+
+#include <string_view>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <array>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <system_error>
+#ifdef __GNUC__
+#include <experimental/filesystem>
+#else
+#include <filesystem>
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#ifdef __GNUC__
+namespace std { namespace filesystem = experimental::filesystem; }
+#endif
+
+inline std::string read_text_file(std::string_view filepath)
+{
+	if (!std::filesystem::exists(filepath.data()))
+	{
+		std::ostringstream message;
+		message << "file " << filepath.data() << " does not exist.";
+		throw std::filesystem::filesystem_error(message.str(), std::make_error_code(std::errc::no_such_file_or_directory));
+	}
+	std::ifstream file(filepath.data());
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+template<typename ... Args>
+std::string string_format(const std::string& format, Args ... args)
+{
+	const size_t size = snprintf(nullptr, 0, format.c_str(), args ...) + 1; // Extra space for '\0'
+	std::unique_ptr<char[]> buf(new char[size]);
+	snprintf(buf.get(), size, format.c_str(), args ...);
+	return std::string(buf.get(), buf.get() + size - 1); // We don't want the '\0' inside
+}
+
+/* submission counters, see add_counter */
+enum struct counter_t
+{
+	draws = 0,
+	instances = 1,
+	triangles = 2,
+	pipeline_binds = 3,
+	texture_binds = 4,
+	uniform_sets = 5,
+	buffer_bytes = 6,
+	texture_bytes = 7,
+	framebuffer_binds = 8
+};
+constexpr size_t counter_count = 9;
+constexpr std::array<const char*, counter_count> counter_names =
+{
+	"draws", "instances", "triangles", "pipeline_binds", "texture_binds", "uniform_sets", "buffer_bytes", "texture_bytes", "framebuffer_binds"
+};
+using counters_t = std::array<uint64_t, counter_count>;
+
+/* window title statistics of the last frames */
+inline std::string format_frame_stats(double frame_time, counters_t const& counters)
+{
+	auto const binds = counters[size_t(counter_t::pipeline_binds)] + counters[size_t(counter_t::texture_binds)] + counters[size_t(counter_t::framebuffer_binds)];
+	auto const uploaded = counters[size_t(counter_t::buffer_bytes)] + counters[size_t(counter_t::texture_bytes)];
+	return string_format("frametime = %.3fms, fps = %.1f, draws = %llu, triangles = %llu, binds = %llu, uniforms = %llu, uploaded = %.1fKB",
+		1000.0*frame_time, 1.0/ frame_time,
+		static_cast<unsigned long long>(counters[size_t(counter_t::draws)]), static_cast<unsigned long long>(counters[size_t(counter_t::triangles)]),
+		static_cast<unsigned long long>(binds), static_cast<unsigned long long>(counters[size_t(counter_t::uniform_sets)]), double(uploaded) / 1024.0);
+}
+
+inline glm::vec3 orbit_axis(float angle, glm::vec3 const& axis, glm::vec3 const& spread) { return glm::angleAxis(angle, axis) * spread; }
+inline float lerp(float a, float b, float f) { return a + f * (b - a); }
+
+enum struct shape_t
+{
+	cube = 0,
+	quad = 1
+};
+
+struct scene_object_t
+{
+	glm::mat4 model;
+	glm::mat4 model_prev;
+	shape_t shape;
+	bool except;
+	scene_object_t(shape_t shape = shape_t::cube, bool except = false) : model(), model_prev(), shape(shape), except(except)
+	{
+
+	}
+};
+
+struct camera_t
+{
+	glm::vec3 position = glm::vec3(0.0f, 0.0f, -7.0f);
+	glm::quat orientation = glm::vec3(0.0f, 0.0f, 0.0f);
+	float rot_x = 0.0f;
+	float rot_y = 0.0f;
+	float fov = glm::radians(60.0f);
+};
+
+inline camera_t create_camera(glm::vec3 const& position, float rot_x, float rot_y)
+{
+	camera_t camera;
+	camera.position = position;
+	camera.rot_x = rot_x;
+	camera.rot_y = rot_y;
+	camera.orientation = glm::quat(glm::vec3(rot_x, rot_y, 0.0f));
+	return camera;
+}
+
+inline glm::mat4 camera_view(camera_t const& camera)
+{
+	auto const forward = camera.orientation * glm::vec3(0.0f, 0.0f, 1.0f);
+	auto const up = camera.orientation * glm::vec3(0.0f, 1.0f, 0.0f);
+	return glm::lookAt(camera.position, camera.position + forward, up);
+}
+
+/* the first camera follows the input, the others are fixed top, side and back views for split-screen */
+struct scene_t
+{
+	std::vector<scene_object_t> objects;
+	std::vector<camera_t> cameras;
+	float cube_speed = 1.0f;
+	float orbit_progression = 0.0f;
+};
+
+inline scene_t create_scene()
+{
+	scene_t scene;
+	scene.objects = {
+		scene_object_t(shape_t::cube),
+		scene_object_t(shape_t::cube),
+		scene_object_t(shape_t::cube),
+		scene_object_t(shape_t::cube),
+		scene_object_t(shape_t::cube),
+		scene_object_t(shape_t::quad)
+	};
+	scene.cameras = {
+		camera_t(),
+		create_camera(glm::vec3(0.0f, 12.0f, 0.0f), glm::half_pi<float>(), 0.0f),
+		create_camera(glm::vec3(12.0f, 0.0f, 0.0f), 0.0f, -glm::half_pi<float>()),
+		create_camera(glm::vec3(0.0f, 0.0f, 12.0f), 0.0f, glm::pi<float>())
+	};
+	return scene;
+}
+
+/* line commands shared by every remote control path, returns false for unknown commands */
+inline bool apply_scene_command(scene_t& scene, std::string const& command)
+{
+	auto& camera = scene.cameras[0];
+	std::istringstream stream(command);
+	std::string name;
+	stream >> name;
+
+	glm::vec3 v = glm::vec3(0.0f);
+	if (name == "camera" && stream >> camera.position.x >> camera.position.y >> camera.position.z >> camera.rot_x >> camera.rot_y) {}
+	else if (name == "move" && stream >> v.x >> v.y >> v.z)		camera.position += v;
+	else if (name == "rotate" && stream >> v.x >> v.y)			{ camera.rot_x += v.x; camera.rot_y += v.y; }
+	else if (name == "speed" && stream >> scene.cube_speed) {}
+	else return false;
+
+	camera.orientation = glm::quat(glm::vec3(camera.rot_x, camera.rot_y, 0.0f));
+	return true;
+}
+
+inline void update_scene(scene_t& scene, bool animate)
+{
+	auto& objects = scene.objects;
+	auto const orbit_progression = scene.orbit_progression;
+	auto const cube_speed = scene.cube_speed;
+
+	/* cube orbit */
+	auto const orbit_center = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	objects[0].model = glm::translate(orbit_center) * glm::rotate(orbit_progression*cube_speed, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	for (auto i = 0; i < 4; i++)
+	{
+		auto const orbit_amount = (orbit_progression * cube_speed + float(i) * 90.0f * glm::pi<float>() / 180.0f);
+		auto const orbit_pos = orbit_axis(orbit_amount, glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 2.0f, 0.0f)) + glm::vec3(-2.0f, 0.0f, 0.0f);
+		objects[1 + i].model = glm::translate(orbit_center + orbit_pos) * glm::rotate(orbit_amount, glm::vec3(0.0f, -1.0f, 0.0f));
+	}
+	if (animate)
+		scene.orbit_progression += 0.1f;
+
+	objects[5].model = glm::translate(glm::vec3(0.0f, -3.0f, 0.0f)) * glm::scale(glm::vec3(10.0f, 1.0f, 10.0f));
+}
+
+/* bounding sphere radius of each shape in object space */
+inline float shape_radius(shape_t shape)
+{
+	switch (shape)
+	{
+	case shape_t::cube: return 0.8660254f;
+	case shape_t::quad: return 0.7071068f;
+	}
+	return 0.0f;
+}
+
+/* normalized clip planes of a view projection matrix, pointing inwards */
+using frustum_t = std::array<glm::vec4, 6>;
+
+inline frustum_t extract_frustum(glm::mat4 const& m)
+{
+	auto const row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+	frustum_t frustum = { row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(3) + row(2), row(3) - row(2) };
+	for (auto& plane : frustum)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+inline bool sphere_in_frustum(frustum_t const& frustum, glm::vec3 const& center, float radius)
+{
+	for (auto const& plane : frustum)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+/* one visible object, drawn into every view whose bit is set in view_mask */
+struct draw_t
+{
+	uint64_t key;
+	uint32_t object;
+	uint32_t view_mask;
+};
+
+/* culls every object against every view, and sorts the survivors by shape so the
+   draw loop changes vertex arrays as rarely as possible */
+inline void cull_objects(std::vector<scene_object_t> const& objects, frustum_t const* frustums, size_t view_count, std::vector<draw_t>& draws)
+{
+	draws.clear();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		auto const& object = objects[i];
+		auto const center = glm::vec3(object.model[3]);
+		auto const scale = glm::max(glm::length(glm::vec3(object.model[0])), glm::max(glm::length(glm::vec3(object.model[1])), glm::length(glm::vec3(object.model[2]))));
+		auto const radius = shape_radius(object.shape) * scale;
+
+		auto view_mask = uint32_t(0);
+		for (size_t v = 0; v < view_count; v++)
+		{
+			if (sphere_in_frustum(frustums[v], center, radius))
+				view_mask |= 1u << v;
+		}
+		if (view_mask)
+			draws.push_back({ (uint64_t(object.shape) << 32) | uint64_t(i), uint32_t(i), view_mask });
+	}
+	std::sort(draws.begin(), draws.end(), [](draw_t const& a, draw_t const& b) { return a.key < b.key; });
+}
+
+/* box filtered mip chain of an 8 bit image, level 0 first and each level half the size of
+   the previous one down to 1x1. each texel averages a 2x2 block, so odd sizes drop their last
+   row and column */
+inline std::vector<std::vector<uint8_t>> generate_mips(uint8_t const* data, int width, int height, int channels)
+{
+	std::vector<std::vector<uint8_t>> levels;
+	levels.emplace_back(data, data + size_t(width) * size_t(height) * size_t(channels));
+	while (width > 1 || height > 1)
+	{
+		auto const& source = levels.back();
+		auto const next_width = std::max(width / 2, 1);
+		auto const next_height = std::max(height / 2, 1);
+		std::vector<uint8_t> level(size_t(next_width) * size_t(next_height) * size_t(channels));
+		for (auto y = 0; y < next_height; y++)
+		{
+			auto const y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (auto x = 0; x < next_width; x++)
+			{
+				auto const x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (auto c = 0; c < channels; c++)
+				{
+					auto const texel = [&](int tx, int ty) { return uint32_t(source[(size_t(ty) * size_t(width) + size_t(tx)) * size_t(channels) + size_t(c)]); };
+					level[(size_t(y) * size_t(next_width) + size_t(x)) * size_t(channels) + size_t(c)] = uint8_t((texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1) + 2) / 4);
+				}
+			}
+		}
+		levels.push_back(std::move(level));
+		width = next_width;
+		height = next_height;
+	}
+	return levels;
+}
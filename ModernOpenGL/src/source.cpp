@@ -1,4 +1,5 @@
 #define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
 
 #include <string_view>
 #include <string>
@@ -12,37 +13,468 @@
 #include <vector>
 #include <chrono>
 #include <numeric>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <unordered_map>
+#include <limits>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
 #ifdef __GNUC__
 #include <experimental/filesystem>
 #else
 #include <filesystem>
 #endif
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern "C" char** environ;
+#endif
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#endif
 
 #include <SDL.h>
 #include <glad/glad.h>
 #include <stb_image.h>
+#include <stb_image_write.h>
+#include <stb_easy_font.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include "scene.hpp"
+
 #ifdef _MSC_VER
 extern "C" { _declspec(dllexport) unsigned int NvOptimusEnablement = 0x00000001; }
 #endif
 
-#ifdef __GNUC__
-namespace std { namespace filesystem = experimental::filesystem; }
-#endif
+/* submission counters, incremented on the hot paths. every thread writes only its own block
+   and readers sum all blocks, so counting costs a thread local add */
+struct thread_counters_t;
 
-inline std::string read_text_file(std::string_view filepath)
+struct counter_registry_t
 {
-	if (!std::filesystem::exists(filepath.data()))
+	std::mutex mutex;
+	std::vector<thread_counters_t*> threads;
+	counters_t retired = {};
+};
+
+inline counter_registry_t& counter_registry()
+{
+	static counter_registry_t registry;
+	return registry;
+}
+
+/* registers on a thread's first count, folds its totals into the registry when the thread exits */
+struct thread_counters_t
+{
+	std::array<std::atomic<uint64_t>, counter_count> values = {};
+
+	thread_counters_t()
 	{
-		std::ostringstream message;
-		message << "file " << filepath.data() << " does not exist.";
-		throw std::filesystem::filesystem_error(message.str(), std::make_error_code(std::errc::no_such_file_or_directory));
+		auto& registry = counter_registry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.threads.push_back(this);
+	}
+
+	~thread_counters_t()
+	{
+		auto& registry = counter_registry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (size_t i = 0; i < counter_count; i++)
+		{
+			registry.retired[i] += values[i].load(std::memory_order_relaxed);
+		}
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+	}
+};
+
+/* only the owning thread writes, so a relaxed load and store is enough */
+inline void add_counter(counter_t counter, uint64_t amount = 1)
+{
+	thread_local thread_counters_t counters;
+	auto& value = counters.values[size_t(counter)];
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+/* monotonic totals over every thread that ever counted */
+counters_t read_counters()
+{
+	auto& registry = counter_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto totals = registry.retired;
+	for (auto const thread : registry.threads)
+	{
+		for (size_t i = 0; i < counter_count; i++)
+		{
+			totals[i] += thread->values[i].load(std::memory_order_relaxed);
+		}
+	}
+	return totals;
+}
+
+/* turns the monotonic totals into per frame amounts, ended once at the end of every frame */
+struct frame_counters_t
+{
+	counters_t last = {};
+	counters_t frame = {};
+};
+
+void end_counter_frame(frame_counters_t& counters)
+{
+	auto const totals = read_counters();
+	for (size_t i = 0; i < counter_count; i++)
+	{
+		counters.frame[i] = totals[i] - counters.last[i];
+	}
+	counters.last = totals;
+}
+
+inline size_t pixel_size(GLenum format, GLenum type)
+{
+	auto const components = [format]() {
+		switch (format)
+		{
+		case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT:	return 1;
+		case GL_RG: case GL_RG_INTEGER:								return 2;
+		case GL_RGB: case GL_RGB_INTEGER:							return 3;
+		case GL_RGBA: case GL_RGBA_INTEGER:							return 4;
+		default: throw std::runtime_error("unsupported pixel format");
+		}
+	}();
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:	return components * 1;
+	case GL_HALF_FLOAT:		return components * 2;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:			return components * 4;
+	case GL_UNSIGNED_INT_5_9_9_9_REV:	return 4;
+	default: throw std::runtime_error("unsupported pixel type");
+	}
+}
+
+/* gpu memory accounting. every texture and buffer the helpers create is registered with its size, computed
+   from the internal format and mip chain. over budget, textures made evictable lose their top mips,
+   least recently bound first */
+enum struct memory_category_t
+{
+	textures,
+	targets,
+	buffers
+};
+constexpr size_t memory_category_count = 3;
+std::array<char const*, memory_category_count> const memory_category_names = { "textures", "targets", "buffers" };
+
+struct gpu_allocation_t
+{
+	memory_category_t category;
+	size_t bytes;
+
+	/* textures only */
+	GLenum target, internal_format;
+	GLsizei width, height, depth, levels;
+};
+
+/* evictable textures are few, so a bind finds their last use with a short scan of atomics instead of
+   taking the registry lock. binding any other texture stamps nothing. owner, where the users find the
+   texture, is only touched under the lock */
+constexpr size_t max_evictable_textures = 16;
+
+struct evictable_texture_t
+{
+	std::atomic<GLuint> texture{ 0 };
+	std::atomic<int64_t> last_use{ 0 };
+	GLuint* owner = nullptr;
+};
+
+struct gpu_memory_t
+{
+	std::mutex mutex;
+	std::unordered_map<GLuint, gpu_allocation_t> textures, buffers;
+	std::array<size_t, memory_category_count> used = {};
+	/* 0 is no budget */
+	size_t budget = 0;
+	std::atomic<int64_t> frame{ 0 };
+
+	std::array<evictable_texture_t, max_evictable_textures> evictable;
+	std::atomic<size_t> evictable_count{ 0 };
+};
+
+inline gpu_memory_t& gpu_memory()
+{
+	static gpu_memory_t memory;
+	return memory;
+}
+
+inline size_t internal_format_size(GLenum internal_format)
+{
+	switch (internal_format)
+	{
+	case GL_R8:													return 1;
+	case GL_RG8:												return 2;
+	case GL_RGB8:												return 3;
+	case GL_RGBA8: case GL_RG16F: case GL_R32UI: case GL_RGB9_E5:
+	case GL_DEPTH_COMPONENT32:									return 4;
+	case GL_RGB16F:												return 6;
+	case GL_RGBA16F:											return 8;
+	default: throw std::runtime_error("unsupported internal format");
+	}
+}
+
+void track_texture(GLuint texture, memory_category_t category, GLenum target, GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth = 1, GLsizei levels = 1)
+{
+	auto bytes = size_t(0);
+	for (auto level = 0; level < levels; level++)
+	{
+		bytes += size_t(std::max(width >> level, 1)) * size_t(std::max(height >> level, 1)) * size_t(depth) * internal_format_size(internal_format);
+	}
+
+	auto& memory = gpu_memory();
+	std::lock_guard<std::mutex> lock(memory.mutex);
+	memory.textures[texture] = { category, bytes, target, internal_format, width, height, depth, levels };
+	memory.used[size_t(category)] += bytes;
+}
+
+void track_buffer(GLuint buffer, size_t bytes)
+{
+	auto& memory = gpu_memory();
+	std::lock_guard<std::mutex> lock(memory.mutex);
+	memory.buffers[buffer] = { memory_category_t::buffers, bytes, GL_NONE, GL_NONE, 0, 0, 0, 0 };
+	memory.used[size_t(memory_category_t::buffers)] += bytes;
+}
+
+void untrack(std::unordered_map<GLuint, gpu_allocation_t>& allocations, std::array<size_t, memory_category_count>& used, GLuint name)
+{
+	auto const allocation = allocations.find(name);
+	if (allocation == allocations.end())
+		return;
+	used[size_t(allocation->second.category)] -= allocation->second.bytes;
+	allocations.erase(allocation);
+}
+
+void delete_textures(std::initializer_list<GLuint> textures)
+{
+	auto& memory = gpu_memory();
+	{
+		std::lock_guard<std::mutex> lock(memory.mutex);
+		for (auto const texture : textures)
+		{
+			untrack(memory.textures, memory.used, texture);
+			for (size_t i = 0; i < memory.evictable_count; i++)
+			{
+				auto& evictable = memory.evictable[i];
+				if (texture && evictable.texture == texture)
+				{
+					evictable.texture = 0;
+					evictable.owner = nullptr;
+				}
+			}
+		}
+	}
+	glDeleteTextures(GLsizei(textures.size()), textures.begin());
+}
+
+void delete_buffers(std::initializer_list<GLuint> buffers)
+{
+	auto& memory = gpu_memory();
+	{
+		std::lock_guard<std::mutex> lock(memory.mutex);
+		for (auto const buffer : buffers)
+			untrack(memory.buffers, memory.used, buffer);
+	}
+	glDeleteBuffers(GLsizei(buffers.size()), buffers.begin());
+}
+
+/* on every bind, so no lock: relaxed atomics are enough for a least recently used order */
+inline void touch_texture(GLuint texture)
+{
+	auto& memory = gpu_memory();
+	auto const count = memory.evictable_count.load(std::memory_order_acquire);
+	for (size_t i = 0; i < count && texture; i++)
+	{
+		auto& evictable = memory.evictable[i];
+		if (evictable.texture.load(std::memory_order_relaxed) == texture)
+		{
+			evictable.last_use.store(memory.frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+/* only mipmapped 2d textures can shrink. *owner is where the renderer finds the texture, and receives
+   the replacement when the top mip is dropped */
+void make_texture_evictable(GLuint* owner)
+{
+	auto& memory = gpu_memory();
+	std::lock_guard<std::mutex> lock(memory.mutex);
+	auto const allocation = memory.textures.find(*owner);
+	if (allocation == memory.textures.end() || allocation->second.target != GL_TEXTURE_2D)
+		return;
+
+	auto const count = memory.evictable_count.load(std::memory_order_relaxed);
+	auto slot = std::find_if(memory.evictable.begin(), memory.evictable.begin() + count, [owner](evictable_texture_t const& evictable) {
+		return evictable.owner == owner || !evictable.owner;
+	}) - memory.evictable.begin();
+	if (size_t(slot) == max_evictable_textures)
+	{
+		std::clog << "too many evictable textures, texture " << *owner << " stays resident\n";
+		return;
+	}
+
+	auto& evictable = memory.evictable[size_t(slot)];
+	evictable.owner = owner;
+	evictable.last_use = memory.frame.load();
+	evictable.texture = *owner;
+	if (size_t(slot) == count)
+		memory.evictable_count.store(count + 1, std::memory_order_release);
+}
+
+void set_gpu_memory_budget(size_t bytes)
+{
+	auto& memory = gpu_memory();
+	std::lock_guard<std::mutex> lock(memory.mutex);
+	memory.budget = bytes;
+}
+
+std::string format_gpu_memory()
+{
+	auto& memory = gpu_memory();
+	std::lock_guard<std::mutex> lock(memory.mutex);
+	std::string report;
+	for (size_t i = 0; i < memory_category_count; i++)
+	{
+		report += string_format("%s %.1f MiB, ", memory_category_names[i], double(memory.used[i]) / double(1 << 20));
+	}
+	report += string_format("total %.1f MiB", double(std::accumulate(memory.used.begin(), memory.used.end(), size_t(0))) / double(1 << 20));
+	if (memory.budget)
+		report += string_format(" of %.1f MiB", double(memory.budget) / double(1 << 20));
+	return report;
+}
+
+/* textures never shrink below this, the budget is then simply exceeded */
+constexpr GLsizei min_evicted_size = 64;
+
+/* once per frame on the context thread. over budget, the least recently bound evictable texture (the largest
+   of equally old ones) is copied into storage without its top mip. one texture a frame keeps every step cheap,
+   so a scene past the budget loses detail gradually instead of paging */
+void update_gpu_memory()
+{
+	auto& memory = gpu_memory();
+	std::unique_lock<std::mutex> lock(memory.mutex);
+	memory.frame++;
+	if (!memory.budget || std::accumulate(memory.used.begin(), memory.used.end(), size_t(0)) <= memory.budget)
+		return;
+
+	evictable_texture_t* victim = nullptr;
+	gpu_allocation_t const* victim_allocation = nullptr;
+	for (size_t i = 0; i < memory.evictable_count; i++)
+	{
+		auto& evictable = memory.evictable[i];
+		auto const allocation = memory.textures.find(evictable.texture);
+		if (!evictable.owner || allocation == memory.textures.end())
+			continue;
+		auto const& a = allocation->second;
+		if (a.levels < 2 || std::min(a.width, a.height) <= min_evicted_size)
+			continue;
+		if (!victim || evictable.last_use < victim->last_use || (evictable.last_use == victim->last_use && a.bytes > victim_allocation->bytes))
+		{
+			victim = &evictable;
+			victim_allocation = &a;
+		}
+	}
+	if (!victim)
+		return;
+
+	auto const old = victim->texture.load();
+	auto const owner = victim->owner;
+	auto const allocation = *victim_allocation;
+	lock.unlock();
+
+	auto const width = std::max(allocation.width >> 1, 1), height = std::max(allocation.height >> 1, 1);
+	auto const levels = allocation.levels - 1;
+	GLuint texture = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, levels, allocation.internal_format, width, height);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	for (auto level = 0; level < levels; level++)
+	{
+		glCopyImageSubData(old, GL_TEXTURE_2D, level + 1, 0, 0, 0, texture, GL_TEXTURE_2D, level, 0, 0, 0, std::max(width >> level, 1), std::max(height >> level, 1), 1);
+	}
+	track_texture(texture, allocation.category, GL_TEXTURE_2D, allocation.internal_format, width, height, 1, levels);
+	{
+		/* the replacement takes over the slot, and with it the last use of the texture it replaces,
+		   or eviction would go round robin */
+		std::lock_guard<std::mutex> relock(memory.mutex);
+		victim->texture = texture;
 	}
-	std::ifstream file(filepath.data());
-	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	*owner = texture;
+	delete_textures({ old });
+	std::clog << string_format("over the gpu memory budget, dropped a texture to %dx%d: %s\n", width, height, format_gpu_memory().c_str());
+}
+
+/* counted versions of the calls the renderer issues every frame */
+inline void bind_program_pipeline(GLuint pipeline)
+{
+	add_counter(counter_t::pipeline_binds);
+	glBindProgramPipeline(pipeline);
+}
+
+inline void bind_texture_unit(GLuint unit, GLuint texture)
+{
+	add_counter(counter_t::texture_binds);
+	touch_texture(texture);
+	glBindTextureUnit(unit, texture);
+}
+
+inline void bind_framebuffer(GLuint framebuffer)
+{
+	add_counter(counter_t::framebuffer_binds);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+inline void upload_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, void const* data)
+{
+	add_counter(counter_t::buffer_bytes, uint64_t(size));
+	glNamedBufferSubData(buffer, offset, size, data);
+}
+
+inline void draw_triangles_indexed(GLsizei index_count, GLenum index_type, GLsizei instances)
+{
+	add_counter(counter_t::draws);
+	add_counter(counter_t::instances, uint64_t(instances));
+	add_counter(counter_t::triangles, uint64_t(index_count / 3) * uint64_t(instances));
+	glDrawElementsInstanced(GL_TRIANGLES, index_count, index_type, nullptr, instances);
+}
+
+inline void draw_triangles(GLsizei vertex_count, GLsizei instances)
+{
+	add_counter(counter_t::draws);
+	add_counter(counter_t::instances, uint64_t(instances));
+	add_counter(counter_t::triangles, uint64_t(vertex_count / 3) * uint64_t(instances));
+	glDrawArraysInstanced(GL_TRIANGLES, 0, vertex_count, instances);
 }
 
 struct vertex_t
@@ -92,6 +524,8 @@ inline GLuint create_buffer(std::vector<T> const& buff, GLenum flags = GL_DYNAMI
 	GLuint name = 0;
 	glCreateBuffers(1, &name);
 	glNamedBufferStorage(name, sizeof(typename std::vector<T>::value_type) * buff.size(), buff.data(), flags);
+	track_buffer(name, sizeof(typename std::vector<T>::value_type) * buff.size());
+	add_counter(counter_t::buffer_bytes, sizeof(typename std::vector<T>::value_type) * buff.size());
 	return name;
 }
 
@@ -133,19 +567,45 @@ void validate_program(GLuint shader, std::string_view filename)
 	}
 }
 
-std::tuple<GLuint, GLuint, GLuint> create_program(std::string_view vert_filepath, std::string_view frag_filepath)
+/* defines go right after the #version line */
+std::string read_shader_source(std::string_view filepath, std::string_view defines = {})
 {
-	auto const vert_source = read_text_file(vert_filepath);
-	auto const frag_source = read_text_file(frag_filepath);
+	auto source = read_text_file(filepath);
+	source.insert(source.find('\n') + 1, defines);
+	return source;
+}
 
-	auto const v_ptr = vert_source.data();
-	auto const f_ptr = frag_source.data();
-	GLuint pipeline = 0;
-	auto vert = glCreateShaderProgramv(GL_VERTEX_SHADER, 1, &v_ptr);
-	auto frag = glCreateShaderProgramv(GL_FRAGMENT_SHADER, 1, &f_ptr);
+/* one separable stage, from source that was read ahead */
+GLuint compile_shader_stage(GLenum stage, std::string const& source, std::string_view filepath)
+{
+	auto const text = source.c_str();
+	auto const shader = glCreateShaderProgramv(stage, 1, &text);
+	validate_program(shader, filepath);
+	return shader;
+}
+
+GLuint create_shader_stage(GLenum stage, std::string_view filepath, std::string_view defines = {})
+{
+	return compile_shader_stage(stage, read_shader_source(filepath, defines), filepath);
+}
+
+/* both stages of a program, read on any thread and compiled on the context thread */
+struct program_source_t
+{
+	std::string vert_filepath, frag_filepath;
+	std::string vert, frag;
+};
 
-	validate_program(vert, vert_filepath);
-	validate_program(frag, frag_filepath);
+program_source_t read_program_source(std::string_view vert_filepath, std::string_view frag_filepath, std::string_view defines = {})
+{
+	return { std::string(vert_filepath), std::string(frag_filepath), read_shader_source(vert_filepath, defines), read_shader_source(frag_filepath, defines) };
+}
+
+std::tuple<GLuint, GLuint, GLuint> create_program(program_source_t const& source)
+{
+	GLuint pipeline = 0;
+	auto vert = compile_shader_stage(GL_VERTEX_SHADER, source.vert, source.vert_filepath);
+	auto frag = compile_shader_stage(GL_FRAGMENT_SHADER, source.frag, source.frag_filepath);
 
 	glCreateProgramPipelines(1, &pipeline);
 	glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vert);
@@ -154,6 +614,11 @@ std::tuple<GLuint, GLuint, GLuint> create_program(std::string_view vert_filepath
 	return std::make_tuple(pipeline, vert, frag);
 }
 
+std::tuple<GLuint, GLuint, GLuint> create_program(std::string_view vert_filepath, std::string_view frag_filepath, std::string_view defines = {})
+{
+	return create_program(read_program_source(vert_filepath, frag_filepath, defines));
+}
+
 GLuint create_shader(GLuint vert, GLuint frag)
 {
 	GLuint pipeline = 0;
@@ -168,6 +633,7 @@ GLuint create_texture_2d(GLenum internal_format, GLenum format, GLsizei width, G
 	GLuint tex = 0;
 	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
 	glTextureStorage2D(tex, 1, internal_format, width, height);
+	track_texture(tex, data ? memory_category_t::textures : memory_category_t::targets, GL_TEXTURE_2D, internal_format, width, height);
 
 	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, filter);
 	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, filter);
@@ -178,23 +644,41 @@ GLuint create_texture_2d(GLenum internal_format, GLenum format, GLsizei width, G
 	if (data)
 	{
 		glTextureSubImage2D(tex, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+		add_counter(counter_t::texture_bytes, size_t(width) * size_t(height) * pixel_size(format, GL_UNSIGNED_BYTE));
 	}
 
 	return tex;
 }
 
+GLuint create_texture_2d_array(GLenum internal_format, GLsizei width, GLsizei height, GLsizei layers, GLenum filter = GL_LINEAR, GLenum repeat = GL_REPEAT)
+{
+	GLuint tex = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &tex);
+	glTextureStorage3D(tex, 1, internal_format, width, height, layers);
+	track_texture(tex, memory_category_t::targets, GL_TEXTURE_2D_ARRAY, internal_format, width, height, layers);
+
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, filter);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, filter);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_S, repeat);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_T, repeat);
+
+	return tex;
+}
+
 template<typename T = nullptr_t>
-GLuint create_texture_cube(GLenum internal_format, GLenum format, GLsizei width, GLsizei height, std::array<T*, 6> const& data)
+GLuint create_texture_cube(GLenum internal_format, GLenum format, GLsizei width, GLsizei height, std::array<T*, 6> const& data, GLenum type = GL_UNSIGNED_BYTE)
 {
 	GLuint tex = 0;
 	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &tex);
 	glTextureStorage2D(tex, 1, internal_format, width, height);
+	track_texture(tex, memory_category_t::textures, GL_TEXTURE_CUBE_MAP, internal_format, width, height, 6);
 
 	for (GLint i = 0; i < 6; ++i)
 	{
 		if (data[i])
 		{
-			glTextureSubImage3D(tex, 0, 0, 0, i, width, height, 1, format, GL_UNSIGNED_BYTE, data[i]);
+			glTextureSubImage3D(tex, 0, 0, 0, i, width, height, 1, format, type, data[i]);
+			add_counter(counter_t::texture_bytes, size_t(width) * size_t(height) * pixel_size(format, type));
 		}
 	}
 
@@ -202,61 +686,246 @@ GLuint create_texture_cube(GLenum internal_format, GLenum format, GLsizei width,
 }
 
 using stb_comp_t = decltype(STBI_default);
-GLuint create_texture_2d_from_file(std::string_view filepath, stb_comp_t comp = STBI_rgb_alpha)
+inline std::pair<GLenum, GLenum> texture_format(stb_comp_t comp)
+{
+	switch (comp)
+	{
+	case STBI_rgb_alpha:	return std::make_pair(GL_RGBA8, GL_RGBA);
+	case STBI_rgb:			return std::make_pair(GL_RGB8, GL_RGB);
+	case STBI_grey:			return std::make_pair(GL_R8, GL_RED);
+	case STBI_grey_alpha:	return std::make_pair(GL_RG8, GL_RG);
+	default: throw std::runtime_error("invalid format");
+	}
+}
+
+/* decoded pixels of one image, level 0 first. decoding needs no context, so it can run on any thread */
+struct image_t
+{
+	int width = 0, height = 0;
+	GLenum internal_format = GL_RGBA8, format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+	std::vector<std::vector<uint8_t>> levels;
+};
+
+inline void require_file(std::string_view filepath)
 {
-	int x, y, c;
 	if (!std::filesystem::exists(filepath.data()))
 	{
 		std::ostringstream message;
 		message << "file " << filepath.data() << " does not exist.";
 		throw std::runtime_error(message.str());
 	}
-	const auto data = stbi_load(filepath.data(), &x, &y, &c, comp);
+}
+
+/* a single level unless mips asks for the box filtered chain down to 1x1 */
+image_t load_image(std::string_view filepath, stb_comp_t comp, bool mips = false)
+{
+	require_file(filepath);
+
+	image_t image;
+	std::tie(image.internal_format, image.format) = texture_format(comp);
+	int c;
+	const auto data = stbi_load(filepath.data(), &image.width, &image.height, &c, comp);
+	if (!data)
+		throw std::runtime_error("failed to decode " + std::string(filepath));
+
+	if (mips)
+		image.levels = generate_mips(data, image.width, image.height, int(comp));
+	else
+		image.levels.emplace_back(data, data + size_t(image.width) * size_t(image.height) * size_t(comp));
+	stbi_image_free(data);
+	return image;
+}
+
+/* linear rgb, as decoded from radiance .hdr files. 8 bit sources keep their values scaled
+   to [0, 1] rather than being linearized, so ldr skies look as they did */
+struct hdr_image_t
+{
+	int width = 0, height = 0;
+	std::vector<glm::vec3> texels;
+};
+
+hdr_image_t load_hdr_image(std::string_view filepath)
+{
+	require_file(filepath);
 
-	auto const[in, ex] = [comp]() {
-		switch (comp)
+	hdr_image_t image;
+	int c;
+	if (stbi_is_hdr(filepath.data()))
+	{
+		const auto data = stbi_loadf(filepath.data(), &image.width, &image.height, &c, STBI_rgb);
+		if (!data)
+			throw std::runtime_error("failed to decode " + std::string(filepath));
+		image.texels.resize(size_t(image.width) * size_t(image.height));
+		for (size_t i = 0; i < image.texels.size(); i++)
 		{
-		case STBI_rgb_alpha:	return std::make_pair(GL_RGBA8, GL_RGBA);
-		case STBI_rgb:			return std::make_pair(GL_RGB8, GL_RGB);
-		case STBI_grey:			return std::make_pair(GL_R8, GL_RED);
-		case STBI_grey_alpha:	return std::make_pair(GL_RG8, GL_RG);
-		default: throw std::runtime_error("invalid format");
+			image.texels[i] = glm::vec3(data[i * 3], data[i * 3 + 1], data[i * 3 + 2]);
 		}
-	}();
+		stbi_image_free(data);
+	}
+	else
+	{
+		const auto data = stbi_load(filepath.data(), &image.width, &image.height, &c, STBI_rgb);
+		if (!data)
+			throw std::runtime_error("failed to decode " + std::string(filepath));
+		image.texels.resize(size_t(image.width) * size_t(image.height));
+		for (size_t i = 0; i < image.texels.size(); i++)
+		{
+			image.texels[i] = glm::vec3(data[i * 3], data[i * 3 + 1], data[i * 3 + 2]) / 255.0f;
+		}
+		stbi_image_free(data);
+	}
+	return image;
+}
 
-	const auto name = create_texture_2d(in, ex, x, y, data);
-	stbi_image_free(data);
-	return name;
+/* rgb9_e5 as the gl spec packs it: three 9 bit mantissas sharing a 5 bit exponent. 4 bytes a texel
+   with no alpha, against 12 for float and 8 for half float rgba */
+inline uint32_t pack_rgb9_e5(glm::vec3 const& color)
+{
+	constexpr auto mantissa_bits = 9;
+	constexpr auto bias = 15;
+	constexpr auto max_value = float(511 << (31 - bias - mantissa_bits));
+
+	auto const c = glm::clamp(color, glm::vec3(0.0f), glm::vec3(max_value));
+	auto const max_component = glm::max(c.r, glm::max(c.g, c.b));
+	if (max_component <= 0.0f)
+		return 0;
+
+	auto exponent = std::max(-bias - 1, int(std::floor(std::log2(max_component)))) + 1 + bias;
+	auto scale = std::exp2(float(exponent - bias - mantissa_bits));
+	if (int(std::floor(max_component / scale + 0.5f)) == 1 << mantissa_bits)
+	{
+		scale *= 2.0f;
+		exponent++;
+	}
+	auto const mantissa = glm::uvec3(glm::floor(c / scale + 0.5f));
+	return mantissa.r | (mantissa.g << 9) | (mantissa.b << 18) | (uint32_t(exponent) << 27);
+}
+
+image_t pack_shared_exponent(hdr_image_t const& source)
+{
+	image_t image;
+	image.width = source.width;
+	image.height = source.height;
+	image.internal_format = GL_RGB9_E5;
+	image.format = GL_RGB;
+	image.type = GL_UNSIGNED_INT_5_9_9_9_REV;
+
+	std::vector<uint8_t> level(source.texels.size() * sizeof(uint32_t));
+	for (size_t i = 0; i < source.texels.size(); i++)
+	{
+		auto const packed = pack_rgb9_e5(source.texels[i]);
+		std::memcpy(level.data() + i * sizeof(uint32_t), &packed, sizeof(uint32_t));
+	}
+	image.levels.push_back(std::move(level));
+	return image;
 }
 
-GLuint create_texture_cube_from_file(std::array<std::string_view, 6> const& filepath, stb_comp_t comp = STBI_rgb_alpha)
+/* one face of a cube map, in gl face order (+x -x +y -y +z -z), sampled from an equirectangular panorama */
+hdr_image_t project_equirect_face(hdr_image_t const& panorama, int face, int size)
 {
-	int x, y, c;
-	std::array<stbi_uc*, 6> faces;
+	hdr_image_t image;
+	image.width = size;
+	image.height = size;
+	image.texels.resize(size_t(size) * size_t(size));
 
-	auto const[in, ex] = [comp]() {
-		switch (comp)
+	for (auto y = 0; y < size; y++)
+	{
+		for (auto x = 0; x < size; x++)
 		{
-		case STBI_rgb_alpha:	return std::make_pair(GL_RGBA8, GL_RGBA);
-		case STBI_rgb:			return std::make_pair(GL_RGB8, GL_RGB);
-		case STBI_grey:			return std::make_pair(GL_R8, GL_RED);
-		case STBI_grey_alpha:	return std::make_pair(GL_RG8, GL_RG);
-		default: throw std::runtime_error("invalid format");
+			auto const s = 2.0f * (float(x) + 0.5f) / float(size) - 1.0f;
+			auto const t = 2.0f * (float(y) + 0.5f) / float(size) - 1.0f;
+			auto const direction = glm::normalize([face, s, t]() {
+				switch (face)
+				{
+				case 0:		return glm::vec3(1.0f, -t, -s);
+				case 1:		return glm::vec3(-1.0f, -t, s);
+				case 2:		return glm::vec3(s, 1.0f, t);
+				case 3:		return glm::vec3(s, -1.0f, -t);
+				case 4:		return glm::vec3(s, -t, 1.0f);
+				default:	return glm::vec3(-s, -t, -1.0f);
+				}
+			}());
+
+			auto const u = 0.5f + std::atan2(direction.x, -direction.z) / glm::two_pi<float>();
+			auto const v = std::acos(glm::clamp(direction.y, -1.0f, 1.0f)) / glm::pi<float>();
+			auto const px = glm::clamp(int(u * float(panorama.width)), 0, panorama.width - 1);
+			auto const py = glm::clamp(int(v * float(panorama.height)), 0, panorama.height - 1);
+			image.texels[size_t(y) * size_t(size) + size_t(x)] = panorama.texels[size_t(py) * size_t(panorama.width) + size_t(px)];
 		}
-	}();
+	}
+	return image;
+}
 
-	for (auto i = 0; i < 6; i++)
+/* a sky is six face files in gl face order, or one equirectangular panorama (a .hdr for range).
+   either way the faces are stored shared exponent */
+std::array<image_t, 6> load_sky(std::vector<std::string> const& paths)
+{
+	std::array<image_t, 6> faces;
+	if (paths.size() == 1)
+	{
+		auto const panorama = load_hdr_image(paths[0]);
+		for (auto i = 0; i < 6; i++)
+		{
+			faces[i] = pack_shared_exponent(project_equirect_face(panorama, i, panorama.width / 4));
+		}
+	}
+	else if (paths.size() == 6)
 	{
-		faces[i] = stbi_load(filepath[i].data(), &x, &y, &c, comp);
+		for (auto i = 0; i < 6; i++)
+		{
+			faces[i] = pack_shared_exponent(load_hdr_image(paths[i]));
+		}
+	}
+	else
+	{
+		throw std::runtime_error("a sky is six face files or one panorama");
 	}
+	return faces;
+}
 
-	const auto name = create_texture_cube(in, ex, x, y, faces);
+/* a sky given by name is the six ./textures/TC_<name>_*.png faces, anything with a dot or slash is a panorama file */
+std::vector<std::string> sky_paths(std::string const& sky)
+{
+	if (sky.find_first_of("./") != std::string::npos)
+		return { sky };
 
-	for (auto face : faces)
+	std::vector<std::string> paths;
+	for (auto const face : { "Xn", "Xp", "Yn", "Yp", "Zn", "Zp" })
 	{
-		stbi_image_free(face);
+		paths.push_back("./textures/TC_" + sky + "_" + face + ".png");
 	}
-	return name;
+	return paths;
+}
+
+GLuint create_texture_2d_from_image(image_t const& image)
+{
+	GLuint tex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, GLsizei(image.levels.size()), image.internal_format, image.width, image.height);
+	track_texture(tex, memory_category_t::textures, GL_TEXTURE_2D, image.internal_format, image.width, image.height, 1, GLsizei(image.levels.size()));
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	/* the small levels have rows that are not 4 byte aligned */
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t level = 0; level < image.levels.size(); level++)
+	{
+		auto const width = std::max(image.width >> level, 1), height = std::max(image.height >> level, 1);
+		glTextureSubImage2D(tex, GLint(level), 0, 0, width, height, image.format, image.type, image.levels[level].data());
+		add_counter(counter_t::texture_bytes, image.levels[level].size());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return tex;
+}
+
+GLuint create_texture_cube_from_images(std::array<image_t, 6> const& faces)
+{
+	std::array<uint8_t const*, 6> data;
+	for (auto i = 0; i < 6; i++)
+	{
+		data[i] = faces[i].levels[0].data();
+	}
+	return create_texture_cube(faces[0].internal_format, faces[0].format, faces[0].width, faces[0].height, data, faces[0].type);
 }
 
 GLuint create_framebuffer(std::vector<GLuint> const& cols, GLuint depth = GL_NONE)
@@ -292,6 +961,7 @@ GLuint create_framebuffer(std::vector<GLuint> const& cols, GLuint depth = GL_NON
 template <typename T>
 inline void set_uniform(GLuint shader, GLint location, T const& value)
 {
+	add_counter(counter_t::uniform_sets);
 	if		constexpr(std::is_same_v<T, GLint>)		glProgramUniform1i(shader, location, value);
 	else if constexpr(std::is_same_v<T, GLuint>)	glProgramUniform1ui(shader, location, value);
 	else if constexpr(std::is_same_v<T, bool>)		glProgramUniform1ui(shader, location, value);
@@ -330,9 +1000,6 @@ inline void delete_items(glDeleterFunc deleter, std::initializer_list<GLuint> it
 	}
 }
 
-inline glm::vec3 orbit_axis(float angle, glm::vec3 const& axis, glm::vec3 const& spread) { return glm::angleAxis(angle, axis) * spread; }
-inline float lerp(float a, float b, float f) { return a + f * (b - a); }
-
 /*
 std::vector<glm::vec3> calc_tangents(std::vector<vertex_t> const& vertices, std::vector<uint8_t> const& indices)
 {
@@ -446,22 +1113,13 @@ void APIENTRY gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum se
 }
 #endif
 
-template<typename ... Args>
-std::string string_format(const std::string& format, Args ... args)
-{
-	const size_t size = snprintf(nullptr, 0, format.c_str(), args ...) + 1; // Extra space for '\0'
-	std::unique_ptr<char[]> buf(new char[size]);
-	snprintf(buf.get(), size, format.c_str(), args ...);
-	return std::string(buf.get(), buf.get() + size - 1); // We don't want the '\0' inside
-}
-
-void measure_frames(SDL_Window* const window, double& deltaTimeAverage, int& frameCounter, int framesToAverage)
+void measure_frames(SDL_Window* const window, double& deltaTimeAverage, int& frameCounter, int framesToAverage, counters_t const& counters)
 {
 	if (frameCounter == framesToAverage)
 	{
 		deltaTimeAverage /= framesToAverage;
 
-		auto window_title = string_format("frametime = %.3fms, fps = %.1f", 1000.0*deltaTimeAverage, 1.0/ deltaTimeAverage);
+		auto const window_title = format_frame_stats(deltaTimeAverage, counters);
 		SDL_SetWindowTitle(window, window_title.c_str());
 
 		deltaTimeAverage = 0.0;
@@ -469,63 +1127,302 @@ void measure_frames(SDL_Window* const window, double& deltaTimeAverage, int& fra
 	}
 }
 
-enum struct shape_t
+template<typename T = std::chrono::milliseconds>
+int64_t now()
+{
+	return std::chrono::duration_cast<T>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+/* trace timestamps, monotonic so the gpu clock can be mapped onto it */
+inline int64_t trace_time_us()
 {
-	cube = 0,
-	quad = 1
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* cpu trace zones in chrome's trace event format. recorded while a capture runs, and into
+   the flight ring of the last few seconds while the hitch recorder is on */
+enum struct trace_phase_t
+{
+	zone,
+	counter,
+	instant
 };
 
-struct scene_object_t
+struct trace_event_t
 {
-	glm::mat4 model;
-	glm::mat4 mvp_inv_prev;
-	shape_t shape;
-	bool except;
-	scene_object_t(shape_t shape = shape_t::cube, bool except = false) : model(), mvp_inv_prev(), shape(shape), except(except)
-	{
+	char const* name;
+	trace_phase_t phase;
+	int64_t begin_us;
+	int64_t end_us;
+	uint32_t thread;
+	double value = 0.0;
+};
+
+/* gpu work shows up as a thread of its own */
+constexpr uint32_t trace_gpu_thread = 1000;
+constexpr int64_t flight_window_us = 3000000;
+
+struct trace_t
+{
+	std::mutex mutex;
+	std::vector<trace_event_t> events;
+	std::atomic<bool> recording = false;
+	int64_t frames_left = 0;
+	std::string path;
+
+	std::deque<trace_event_t> flight_events;
+	std::atomic<bool> flight = false;
+};
+
+inline trace_t& trace_recorder()
+{
+	static trace_t trace;
+	return trace;
+}
+
+inline bool trace_active()
+{
+	auto const& trace = trace_recorder();
+	return trace.recording.load(std::memory_order_relaxed) || trace.flight.load(std::memory_order_relaxed);
+}
 
+inline uint32_t trace_thread_id()
+{
+	static std::atomic<uint32_t> next = 0;
+	thread_local auto const id = next.fetch_add(1, std::memory_order_relaxed);
+	return id;
+}
+
+void record_trace_event(trace_event_t const& event)
+{
+	auto& trace = trace_recorder();
+	std::lock_guard<std::mutex> lock(trace.mutex);
+	if (trace.recording.load(std::memory_order_relaxed))
+		trace.events.push_back(event);
+	if (trace.flight.load(std::memory_order_relaxed))
+	{
+		trace.flight_events.push_back(event);
+		while (trace.flight_events.front().end_us < event.end_us - flight_window_us)
+			trace.flight_events.pop_front();
 	}
+}
+
+/* frame values such as counters, plotted as graphs */
+inline void record_trace_counter(char const* name, double value)
+{
+	if (!trace_active())
+		return;
+	auto const time = trace_time_us();
+	record_trace_event({ name, trace_phase_t::counter, time, time, trace_thread_id(), value });
+}
+
+/* single points in time such as input */
+inline void record_trace_instant(char const* name)
+{
+	if (!trace_active())
+		return;
+	auto const time = trace_time_us();
+	record_trace_event({ name, trace_phase_t::instant, time, time, trace_thread_id() });
+}
+
+/* zones nest per thread, names must outlive the capture */
+struct trace_zone_state_t
+{
+	char const* name;
+	int64_t begin_us;
 };
 
-template<typename T = std::chrono::milliseconds>
-int64_t now()
+inline std::vector<trace_zone_state_t>& trace_zone_stack()
 {
-	return std::chrono::duration_cast<T>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	thread_local std::vector<trace_zone_state_t> stack;
+	return stack;
 }
 
-int main(int argc, char* argv[])
+inline void begin_trace_zone(char const* name)
 {
-	constexpr auto window_width = 1920;
-	constexpr auto window_height = 1080;
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
-	const auto window = SDL_CreateWindow("ModernOpenGL\0", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width, window_height, SDL_WINDOW_OPENGL);
-	const auto gl_context = SDL_GL_CreateContext(window);
-	//SDL_GL_SetSwapInterval(0);
-	auto ev = SDL_Event();
+	trace_zone_stack().push_back({ name, trace_active() ? trace_time_us() : -1 });
+}
 
-	auto key_count = 0;
-	const auto key_state = SDL_GetKeyboardState(&key_count);
+inline void end_trace_zone()
+{
+	auto& stack = trace_zone_stack();
+	auto const zone = stack.back();
+	stack.pop_back();
+
+	if (zone.begin_us < 0 || !trace_active())
+		return;
+	record_trace_event({ zone.name, trace_phase_t::zone, zone.begin_us, trace_time_us(), trace_thread_id() });
+}
+
+struct trace_zone_t
+{
+	explicit trace_zone_t(char const* name) { begin_trace_zone(name); }
+	~trace_zone_t() { end_trace_zone(); }
+	trace_zone_t(trace_zone_t const&) = delete;
+	trace_zone_t& operator=(trace_zone_t const&) = delete;
+};
 
-	std::array<bool, 512> key;
-	std::array<bool, 512> key_pressed;
-	std::array<bool, 512> key_released;
+/* records the next frame_count frames, false while another capture is still running */
+bool begin_trace_capture(int64_t frame_count, std::string const& path)
+{
+	auto& trace = trace_recorder();
+	if (frame_count < 1 || trace.recording.load(std::memory_order_relaxed))
+		return false;
+
+	std::lock_guard<std::mutex> lock(trace.mutex);
+	trace.events.clear();
+	trace.frames_left = frame_count;
+	trace.path = path;
+	trace.recording.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+void write_trace(std::string const& path, std::vector<trace_event_t> const& events)
+{
+	std::ofstream file(path);
+	if (!file)
+		throw std::runtime_error("failed to open trace file " + path);
 
-	auto const[screen_width, screen_height] = []()
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << trace_gpu_thread << ",\"args\":{\"name\":\"gpu\"}}";
+	for (auto const& event : events)
 	{
-		SDL_DisplayMode display_mode;
-		SDL_GetCurrentDisplayMode(0, &display_mode);
-		return std::pair<int, int>(display_mode.w, display_mode.h);
-	}();
+		/* key names may be quotes or backslashes */
+		std::string name;
+		for (auto const* c = event.name; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				name += '\\';
+			name += *c;
+		}
+
+		file << ",\n{\"name\":\"" << name << "\",\"pid\":0,\"tid\":" << event.thread << ",\"ts\":" << event.begin_us;
+		switch (event.phase)
+		{
+		case trace_phase_t::zone: file << ",\"ph\":\"X\",\"dur\":" << event.end_us - event.begin_us << '}'; break;
+		case trace_phase_t::counter: file << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}"; break;
+		case trace_phase_t::instant: file << ",\"ph\":\"i\",\"s\":\"g\"}"; break;
+		}
+	}
+	file << "\n]}\n";
+}
+
+/* called by the render thread once per frame, writes the capture out after its last frame */
+void end_trace_frame()
+{
+	auto& trace = trace_recorder();
+	if (!trace.recording.load(std::memory_order_relaxed) || --trace.frames_left > 0)
+		return;
 
-	if (!gladLoadGL())
+	std::vector<trace_event_t> events;
+	std::string path;
 	{
-		SDL_GL_DeleteContext(gl_context);
-		SDL_DestroyWindow(window);
-		throw std::runtime_error("failed to load gl");
+		std::lock_guard<std::mutex> lock(trace.mutex);
+		trace.recording.store(false, std::memory_order_relaxed);
+		events.swap(trace.events);
+		path.swap(trace.path);
 	}
+	write_trace(path, events);
+	std::clog << "wrote " << events.size() << " trace events to " << path << '\n';
+}
 
-	std::clog << glGetString(GL_VERSION) << '\n';
+/* hitch recorder: keeps the flight ring filling, and once a frame goes over budget waits
+   for a few more frames before dumping the ring, so the trace shows both sides of it */
+constexpr int64_t hitch_frames_after = 30;
+
+struct hitch_recorder_t
+{
+	double budget_ms;
+	std::string directory;
+	int64_t dump_frame = -1;
+	int64_t hitch_frame = -1;
+	std::thread writer;
+};
+
+std::unique_ptr<hitch_recorder_t> create_hitch_recorder(double budget_ms, std::string const& directory)
+{
+	auto recorder = std::make_unique<hitch_recorder_t>();
+	recorder->budget_ms = budget_ms;
+	recorder->directory = directory;
+	trace_recorder().flight.store(true, std::memory_order_relaxed);
+	return recorder;
+}
+
+/* render thread, once per frame. the file is written off it so the dump is no hitch of its own */
+void update_hitch_recorder(hitch_recorder_t& recorder, int64_t frame, double frame_ms)
+{
+	if (recorder.dump_frame < 0)
+	{
+		if (frame_ms <= recorder.budget_ms)
+			return;
+		record_trace_instant("hitch");
+		recorder.hitch_frame = frame;
+		recorder.dump_frame = frame + hitch_frames_after;
+		std::clog << string_format("frame %lld took %.2fms, over the %.2fms budget\n", static_cast<long long>(frame), frame_ms, recorder.budget_ms);
+		return;
+	}
+	if (frame < recorder.dump_frame)
+		return;
+
+	auto& trace = trace_recorder();
+	std::vector<trace_event_t> events;
+	{
+		std::lock_guard<std::mutex> lock(trace.mutex);
+		events.assign(trace.flight_events.begin(), trace.flight_events.end());
+	}
+	if (recorder.writer.joinable())
+		recorder.writer.join();
+
+	auto const path = recorder.directory + "/hitch-" + std::to_string(recorder.hitch_frame) + ".json";
+	recorder.writer = std::thread([path, events = std::move(events)]() {
+		write_trace(path, events);
+		std::clog << "wrote " << events.size() << " trace events to " << path << '\n';
+	});
+	recorder.dump_frame = -1;
+}
+
+void delete_hitch_recorder(hitch_recorder_t& recorder)
+{
+	trace_recorder().flight.store(false, std::memory_order_relaxed);
+	if (recorder.writer.joinable())
+		recorder.writer.join();
+}
+
+/* a frame's submission counters and time, as graphs next to the zones */
+void record_trace_frame(counters_t const& counters, double frame_ms)
+{
+	if (!trace_active())
+		return;
+	record_trace_counter("frame_ms", frame_ms);
+	for (size_t i = 0; i < counter_count; i++)
+		record_trace_counter(counter_names[i], double(counters[i]));
+}
 
+/* uniforms */
+constexpr auto uniform_cam_pos = 0;
+constexpr auto uniform_sky_fade = 1;
+constexpr auto uniform_cam_dir = 0;
+constexpr auto uniform_fov = 1;
+constexpr auto uniform_aspect = 2;
+constexpr auto uniform_lght = 3;
+constexpr auto uniform_blur_bias = 0;
+constexpr auto uniform_blur_rect = 1;
+constexpr auto uniform_uvs_diff = 3;
+constexpr auto uniform_uvs_offset = 5;
+constexpr auto uniform_object_index = 0;
+constexpr auto uniform_tile = 4;
+constexpr auto uniform_feedback = 0;
+constexpr auto uniform_feedback_sizes = 1;
+
+/* buffer bindings */
+constexpr auto block_view = 0;
+constexpr auto block_objects = 0;
+constexpr auto block_feedback = 2;
+
+constexpr uint32_t no_object = 0;
+
+void register_debug_callback()
+{
 #if _DEBUG
 	if (glDebugMessageCallback)
 	{
@@ -540,11 +1437,140 @@ int main(int argc, char* argv[])
 		std::clog << "glDebugMessageCallback not available\n";
 	}
 #endif
+}
 
-	glEnable(GL_CULL_FACE);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_PROGRAM_POINT_SIZE);
+/* startup task graph: every task runs once all of its dependencies finished. worker tasks (file reads,
+   decodes) run on a pool, context tasks (gl object creation) on the thread that owns the context.
+   dependencies are added before their dependents, so a graph can not have cycles */
+enum struct task_queue_t
+{
+	worker,
+	context
+};
+
+struct task_t
+{
+	char const* name;
+	task_queue_t queue;
+	std::function<void()> work;
+	std::vector<size_t> dependents;
+	size_t dependency_count;
+};
+
+struct task_graph_t
+{
+	std::vector<task_t> tasks;
+};
+
+/* names show up as trace zones and must outlive the capture */
+size_t add_task(task_graph_t& graph, char const* name, task_queue_t queue, std::function<void()> work, std::vector<size_t> const& dependencies = {})
+{
+	auto const index = graph.tasks.size();
+	for (auto const dependency : dependencies)
+	{
+		graph.tasks[dependency].dependents.push_back(index);
+	}
+	graph.tasks.push_back({ name, queue, std::move(work), {}, dependencies.size() });
+	return index;
+}
+
+/* must be called on the context thread. the first exception stops scheduling, and is rethrown
+   once the tasks already running finished */
+void run_task_graph(task_graph_t& graph, unsigned worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+{
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::array<std::deque<size_t>, 2> queues;
+	std::vector<size_t> remaining(graph.tasks.size());
+	size_t finished = 0;
+	std::exception_ptr error;
+
+	for (size_t i = 0; i < graph.tasks.size(); i++)
+	{
+		remaining[i] = graph.tasks[i].dependency_count;
+		if (remaining[i] == 0)
+			queues[size_t(graph.tasks[i].queue)].push_back(i);
+	}
+
+	auto const run = [&](task_queue_t queue)
+	{
+		auto& pending = queues[size_t(queue)];
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			ready.wait(lock, [&]() { return finished == graph.tasks.size() || error || !pending.empty(); });
+			if (finished == graph.tasks.size() || error)
+				return;
+
+			auto& task = graph.tasks[pending.front()];
+			pending.pop_front();
+			lock.unlock();
+
+			std::exception_ptr failure;
+			try
+			{
+				trace_zone_t zone(task.name);
+				task.work();
+			}
+			catch (...)
+			{
+				failure = std::current_exception();
+			}
+
+			lock.lock();
+			if (failure)
+			{
+				error = error ? error : failure;
+			}
+			else
+			{
+				finished++;
+				for (auto const dependent : task.dependents)
+				{
+					if (--remaining[dependent] == 0)
+						queues[size_t(graph.tasks[dependent].queue)].push_back(dependent);
+				}
+			}
+			ready.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < worker_count; i++)
+	{
+		workers.emplace_back(run, task_queue_t::worker);
+	}
+	run(task_queue_t::context);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+/* textures and buffers are shared by every renderer instance, contexts sharing with the creating one use them as is */
+struct assets_t
+{
+	GLuint texture_cube_diffuse, texture_cube_specular, texture_cube_normal;
+	GLuint texture_skybox;
+	GLuint vbo_cube, ibo_cube;
+	GLuint vbo_quad, ibo_quad;
+	GLsizei index_count_cube, index_count_quad;
+};
 
+/* vertex formatting information */
+std::vector<attrib_format_t> const vertex_format =
+{
+	create_attrib_format<glm::vec3>(0, offsetof(vertex_t, position)),
+	create_attrib_format<glm::vec3>(1, offsetof(vertex_t, color)),
+	create_attrib_format<glm::vec3>(2, offsetof(vertex_t, normal)),
+	create_attrib_format<glm::vec2>(3, offsetof(vertex_t, texcoord))
+};
+
+void create_asset_geometry(assets_t& assets)
+{
 	std::vector<vertex_t> const vertices_cube =
 	{
 		vertex_t(glm::vec3(-0.5f, 0.5f,-0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f,-1.0f), glm::vec2(0.0f, 0.0f)),
@@ -602,293 +1628,4599 @@ int main(int argc, char* argv[])
 		0,   1,  2,  2,  3,  0,
 	};
 
-	auto const texture_cube_diffuse = create_texture_2d_from_file("./textures/T_Default_D.png", STBI_rgb);
-	auto const texture_cube_specular = create_texture_2d_from_file("./textures/T_Default_S.png", STBI_grey);
-	auto const texture_cube_normal = create_texture_2d_from_file("./textures/T_Default_N.png", STBI_rgb);
-	auto const texture_skybox = create_texture_cube_from_file({
-			"./textures/TC_SkySpace_Xn.png",
-			"./textures/TC_SkySpace_Xp.png",
-			"./textures/TC_SkySpace_Yn.png",
-			"./textures/TC_SkySpace_Yp.png",
-			"./textures/TC_SkySpace_Zn.png",
-			"./textures/TC_SkySpace_Zp.png"
-		});
-
-	/* framebuffer textures */
-	auto const texture_gbuffer_color = create_texture_2d(GL_RGB8, GL_RGB, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_gbuffer_position = create_texture_2d(GL_RGB16F, GL_RGB, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_gbuffer_normal = create_texture_2d(GL_RGB16F, GL_RGB, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_gbuffer_albedo = create_texture_2d(GL_RGBA16F, GL_RGBA, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_gbuffer_depth = create_texture_2d(GL_DEPTH_COMPONENT32, GL_DEPTH, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_gbuffer_velocity = create_texture_2d(GL_RG16F, GL_RG, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_motion_blur = create_texture_2d(GL_RGB8, GL_RGB, screen_width, screen_height, nullptr, GL_NEAREST);
-	auto const texture_motion_blur_mask = create_texture_2d(GL_R8, GL_RED, screen_width, screen_height, nullptr, GL_NEAREST);
-
-	auto const fb_gbuffer = create_framebuffer({ texture_gbuffer_position, texture_gbuffer_normal, texture_gbuffer_albedo, texture_gbuffer_velocity }, texture_gbuffer_depth);
-	auto const fb_finalcolor = create_framebuffer({ texture_gbuffer_color });
-	auto const fb_blur = create_framebuffer({ texture_motion_blur });
-
-	/* vertex formatting information */
-	std::vector<attrib_format_t> const vertex_format =
-	{
-		create_attrib_format<glm::vec3>(0, offsetof(vertex_t, position)),
-		create_attrib_format<glm::vec3>(1, offsetof(vertex_t, color)),
-		create_attrib_format<glm::vec3>(2, offsetof(vertex_t, normal)),
-		create_attrib_format<glm::vec2>(3, offsetof(vertex_t, texcoord))
-	};
-
-	/* geometry buffers */
-	auto const vao_empty = [] { GLuint name = 0; glCreateVertexArrays(1, &name); return name; }();
-	auto const[vao_cube, vbo_cube, ibo_cube] = create_geometry(vertices_cube, indices_cube, vertex_format);
-	auto const[vao_quad, vbo_quad, ibo_quad] = create_geometry(vertices_quad, indices_quad, vertex_format);
-
-	/* shaders */
-	auto const[pr, vert_shader, frag_shader] = create_program("./shaders/main.vert", "./shaders/main.frag");
-	auto const[pr_g, vert_shader_g, frag_shader_g] = create_program("./shaders/gbuffer.vert", "./shaders/gbuffer.frag");
-	auto const[pr_blur, vert_shader_blur, frag_shader_blur] = create_program("./shaders/blur.vert", "./shaders/blur.frag");
-
-	/* uniforms */
-	constexpr auto uniform_projection = 0;
-	constexpr auto uniform_cam_pos = 0;
-	constexpr auto uniform_cam_dir = 0;
-	constexpr auto uniform_view = 1;
-	constexpr auto uniform_fov = 1;
-	constexpr auto uniform_aspect = 2;
-	constexpr auto uniform_modl = 2;
-	constexpr auto uniform_lght = 3;
-	constexpr auto uniform_blur_bias = 0;
-	constexpr auto uniform_uvs_diff = 3;
-	constexpr auto uniform_mvp = 3;
-	constexpr auto uniform_mvp_inverse = 4;
-	constexpr auto uniform_blur_except = 5;
-
-	constexpr auto fov = glm::radians(60.0f);
-	auto const camera_projection = glm::perspective(fov, float(window_width) / float(window_height), 0.1f, 1000.0f);
-	set_uniform(vert_shader_g, uniform_projection, camera_projection);
-
-	auto t1 = SDL_GetTicks() / 1000.0;
+	assets.vbo_cube = create_buffer(vertices_cube);
+	assets.ibo_cube = create_buffer(indices_cube);
+	assets.vbo_quad = create_buffer(vertices_quad);
+	assets.ibo_quad = create_buffer(indices_quad);
+	assets.index_count_cube = GLsizei(indices_cube.size());
+	assets.index_count_quad = GLsizei(indices_quad.size());
+}
 
-	const auto framesToAverage = 10;
-	auto deltaTimeAverage = 0.0;  // first moment
-	auto frameCounter = 0;
+char const* const diffuse_texture_path = "./textures/T_Default_D.png";
+char const* const specular_texture_path = "./textures/T_Default_S.png";
+char const* const normal_texture_path = "./textures/T_Default_N.png";
+char const* const default_sky = "SkySpace";
+std::array<char const*, 3> const shipped_skies = { "SkySpace", "SkyRed", "AboveClouds" };
 
-	std::vector<scene_object_t> objects = {
-		scene_object_t(shape_t::cube),
-		scene_object_t(shape_t::cube),
-		scene_object_t(shape_t::cube),
-		scene_object_t(shape_t::cube),
-		scene_object_t(shape_t::cube),
-		scene_object_t(shape_t::quad)
+/* adds loading the assets to a startup graph, returns the task after which all of them exist.
+   without textures only the geometry loads, the textures are then up to the caller */
+size_t add_asset_tasks(task_graph_t& graph, assets_t& assets, std::string const& sky = default_sky, bool textures = true)
+{
+	/* decoded on a worker, uploaded and released on the context thread. the material textures get a full mip
+	   chain, over the gpu memory budget eviction drops their top levels and needs coarser ones to fall back on */
+	auto const add_texture_2d = [&graph](char const* filepath, stb_comp_t comp, GLuint& texture) {
+		auto const image = std::make_shared<image_t>();
+		auto const decode = add_task(graph, filepath, task_queue_t::worker, [image, filepath, comp]() { *image = load_image(filepath, comp, true); });
+		return add_task(graph, "upload texture", task_queue_t::context, [image, &texture]() {
+			texture = create_texture_2d_from_image(*image);
+			*image = {};
+		}, { decode });
 	};
 
-	auto curr_time = now();
-	auto frames = int64_t(0);
-	while (ev.type != SDL_QUIT)
-	{
-		const auto t2 = SDL_GetTicks() / 1000.0;
-		const auto dt = t2 - t1;
-		t1 = t2;
-
-		deltaTimeAverage += dt;
-		frameCounter++;
-
-		measure_frames(window, deltaTimeAverage, frameCounter, framesToAverage);
+	/* the same as load_sky, with the faces decoded, or projected out of a panorama, in parallel */
+	auto const add_sky = [&graph](std::vector<std::string> const& paths, GLuint& texture) {
+		if (paths.size() != 1 && paths.size() != 6)
+			throw std::runtime_error("a sky is six face files or one panorama");
 
-		if (SDL_PollEvent(&ev))
+		auto const faces = std::make_shared<std::array<image_t, 6>>();
+		std::vector<size_t> packed;
+		if (paths.size() == 1)
 		{
-			for (int i = 0; i < key_count; i++)
+			auto const panorama = std::make_shared<hdr_image_t>();
+			auto const decode = add_task(graph, "decode panorama", task_queue_t::worker, [panorama, path = paths[0]]() { *panorama = load_hdr_image(path); });
+			for (size_t i = 0; i < faces->size(); i++)
 			{
-				key_pressed[i] = !key[i] && key_state[i];
-				key_released[i] = key[i] && !key_state[i];
-				key[i] = bool(key_state[i]);
+				packed.push_back(add_task(graph, "project sky face", task_queue_t::worker, [faces, panorama, i]() {
+					(*faces)[i] = pack_shared_exponent(project_equirect_face(*panorama, int(i), panorama->width / 4));
+				}, { decode }));
 			}
 		}
-		static auto rot_x = 0.0f;
-		static auto rot_y = 0.0f;
-		static glm::vec3 camera_position = glm::vec3(0.0f, 0.0f, -7.0f);
-		static glm::quat camera_orientation = glm::vec3(0.0f, 0.0f, 0.0f);
-		auto const camera_forward = camera_orientation * glm::vec3(0.0f, 0.0f, 1.0f);
-		auto const camera_up = camera_orientation * glm::vec3(0.0f, 1.0f, 0.0f);
-		auto const camera_right = camera_orientation * glm::vec3(1.0f, 0.0f, 0.0f);
-
-		if (key[SDL_SCANCODE_ESCAPE])
-			ev.type = SDL_QUIT;
-
-		if (key[SDL_SCANCODE_LEFT])		rot_y += 0.025f;
-		if (key[SDL_SCANCODE_RIGHT])	rot_y -= 0.025f;
-		if (key[SDL_SCANCODE_UP])		rot_x -= 0.025f;
-		if (key[SDL_SCANCODE_DOWN])		rot_x += 0.025f;
-
-		camera_orientation = glm::quat(glm::vec3(rot_x, rot_y, 0.0f));
-
-		if (key[SDL_SCANCODE_W]) camera_position += camera_forward * 0.1f;
-		if (key[SDL_SCANCODE_A]) camera_position += camera_right * 0.1f;
-		if (key[SDL_SCANCODE_S]) camera_position -= camera_forward * 0.1f;
-		if (key[SDL_SCANCODE_D]) camera_position -= camera_right * 0.1f;
+		else
+		{
+			for (size_t i = 0; i < faces->size(); i++)
+			{
+				packed.push_back(add_task(graph, "decode sky face", task_queue_t::worker, [faces, i, path = paths[i]]() { (*faces)[i] = pack_shared_exponent(load_hdr_image(path)); }));
+			}
+		}
+		return add_task(graph, "upload sky", task_queue_t::context, [faces, &texture]() {
+			texture = create_texture_cube_from_images(*faces);
+			*faces = {};
+		}, packed);
+	};
 
-		static float cube_speed = 1.0f;
-		if (key[SDL_SCANCODE_Q]) cube_speed -= 0.01f;
-		if (key[SDL_SCANCODE_E]) cube_speed += 0.01f;
+	std::vector<size_t> loaded = { add_task(graph, "geometry", task_queue_t::context, [&assets]() { create_asset_geometry(assets); }) };
+	if (textures)
+	{
+		loaded.push_back(add_texture_2d(diffuse_texture_path, STBI_rgb, assets.texture_cube_diffuse));
+		loaded.push_back(add_texture_2d(specular_texture_path, STBI_grey, assets.texture_cube_specular));
+		loaded.push_back(add_texture_2d(normal_texture_path, STBI_rgb, assets.texture_cube_normal));
+		loaded.push_back(add_sky(sky_paths(sky), assets.texture_skybox));
+	}
+	return add_task(graph, "assets", task_queue_t::context, []() {}, loaded);
+}
 
-		auto const camera_view = glm::lookAt(camera_position, camera_position + camera_forward, camera_up);
-		
-		/* cube orbit */
-		auto const orbit_center = glm::vec3(0.0f, 0.0f, 0.0f);
-		static auto orbit_progression = 0.0f;
+assets_t create_assets(std::string const& sky = default_sky)
+{
+	task_graph_t graph;
+	assets_t assets;
+	add_asset_tasks(graph, assets, sky);
+	run_task_graph(graph);
+	return assets;
+}
 
-		objects[0].model = glm::translate(orbit_center) * glm::rotate(orbit_progression*cube_speed, glm::vec3(0.0f, 1.0f, 0.0f));
+void delete_assets(assets_t const& assets)
+{
+	delete_buffers(
+		{
+		assets.vbo_cube,
+		assets.ibo_cube,
 
-		for (auto i = 0; i < 4; i++)
+		assets.vbo_quad,
+		assets.ibo_quad,
+		});
+	delete_textures(
 		{
-			auto const orbit_amount = (orbit_progression * cube_speed + float(i) * 90.0f * glm::pi<float>() / 180.0f);
-			auto const orbit_pos = orbit_axis(orbit_amount, glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 2.0f, 0.0f)) + glm::vec3(-2.0f, 0.0f, 0.0f);
-			objects[1 + i].model = glm::translate(orbit_center + orbit_pos) * glm::rotate(orbit_amount, glm::vec3(0.0f, -1.0f, 0.0f));
-		}
-		orbit_progression += 0.1f;
+		assets.texture_cube_diffuse,
+		assets.texture_cube_specular,
+		assets.texture_cube_normal,
+
+		assets.texture_skybox,
+		});
+}
 
-		objects[5].model = glm::translate(glm::vec3(0.0f, -3.0f, 0.0f)) * glm::scale(glm::vec3(10.0f, 1.0f, 10.0f));
+/* asynchronous texture loading. a request returns a handle at once, which resolves to a built in 1x1
+   placeholder until the texture is resident: workers decode the most urgent request first, and the
+   context thread uploads a few decoded ones per frame. requests for the same files coalesce */
+using asset_handle_t = uint64_t;
 
-		set_uniform(vert_shader_g, uniform_view, camera_view);
+enum struct placeholder_t
+{
+	grey,
+	flat_normal,
+	black
+};
+constexpr size_t placeholder_count = 3;
 
-		/* g-buffer pass */
-		static auto const viewport_width = screen_width;
-		static auto const viewport_height = screen_height;
-		glViewport(0, 0, viewport_width, viewport_height);
+enum struct asset_state_t
+{
+	queued,
+	loading,
+	decoded,
+	resident,
+	failed,
+	cancelled
+};
 
-		auto const depth_clear_val = 1.0f;
-		glClearNamedFramebufferfv(fb_gbuffer, GL_COLOR, 0, glm::value_ptr(glm::vec3(0.0f)));
-		glClearNamedFramebufferfv(fb_gbuffer, GL_COLOR, 1, glm::value_ptr(glm::vec3(0.0f)));
-		glClearNamedFramebufferfv(fb_gbuffer, GL_COLOR, 2, glm::value_ptr(glm::vec4(0.0f)));
-		glClearNamedFramebufferfv(fb_gbuffer, GL_COLOR, 3, glm::value_ptr(glm::vec2(0.0f)));
-		glClearNamedFramebufferfv(fb_gbuffer, GL_DEPTH, 0, &depth_clear_val);
+struct asset_request_t
+{
+	std::string key;
+	/* one file for a 2d texture, the sky_paths for a cube */
+	std::vector<std::string> paths;
+	bool cube;
+	stb_comp_t comp;
+	placeholder_t placeholder;
+	/* higher priorities load first */
+	float priority;
+	size_t references;
+	asset_state_t state;
+	std::vector<image_t> images;
+	GLuint texture;
+	/* bumped whenever the slot is reused for another request */
+	uint32_t generation;
+};
 
-		glBindFramebuffer(GL_FRAMEBUFFER, fb_gbuffer);
+struct asset_manager_t
+{
+	std::mutex mutex;
+	std::condition_variable wake;
+	/* cancelled requests leave their slot on free_slots for the next request to reuse */
+	std::vector<asset_request_t> requests;
+	std::vector<size_t> free_slots;
+	std::unordered_map<std::string, asset_handle_t> handles;
+	std::vector<std::thread> workers;
+	bool quit = false;
+
+	std::array<GLuint, placeholder_count> placeholders;
+	GLuint placeholder_cube;
+};
 
-		glBindTextureUnit(0, texture_cube_diffuse);
-		glBindTextureUnit(1, texture_cube_specular);
-		glBindTextureUnit(2, texture_cube_normal);
+/* a handle is the slot of its request in the low bits and the generation of that slot in the high ones,
+   so a handle kept past cancel_asset never resolves to the request that reused its slot */
+inline asset_handle_t make_asset_handle(size_t slot, uint32_t generation)
+{
+	return (asset_handle_t(generation) << 32) | asset_handle_t(slot);
+}
 
-		glBindProgramPipeline(pr_g);
+/* nullptr for a cancelled request. called with the manager locked */
+inline asset_request_t* find_asset_request(asset_manager_t& manager, asset_handle_t handle)
+{
+	auto const slot = size_t(handle & 0xffffffff);
+	if (slot >= manager.requests.size())
+		return nullptr;
+	auto& request = manager.requests[slot];
+	if (request.generation != uint32_t(handle >> 32) || request.state == asset_state_t::cancelled)
+		return nullptr;
+	return &request;
+}
 
-		for (auto& object : objects)
+void run_asset_worker(asset_manager_t& manager)
+{
+	std::unique_lock<std::mutex> lock(manager.mutex);
+	while (true)
+	{
+		auto next = manager.requests.end();
+		manager.wake.wait(lock, [&manager, &next]() {
+			next = manager.requests.end();
+			for (auto request = manager.requests.begin(); request != manager.requests.end(); ++request)
+			{
+				if (request->state == asset_state_t::queued && (next == manager.requests.end() || request->priority > next->priority))
+					next = request;
+			}
+			return manager.quit || next != manager.requests.end();
+		});
+		if (manager.quit)
+			return;
+
+		auto const slot = size_t(next - manager.requests.begin());
+		auto const generation = next->generation;
+		auto const paths = next->paths;
+		auto const cube = next->cube;
+		auto const comp = next->comp;
+		next->state = asset_state_t::loading;
+		lock.unlock();
+
+		/* a missing or broken file leaves the placeholder in place */
+		std::vector<image_t> images;
+		auto failed = false;
+		try
 		{
-			switch (object.shape)
+			trace_zone_t const zone("decode asset");
+			if (cube)
 			{
-			case shape_t::cube: glBindVertexArray(vao_cube); break;
-			case shape_t::quad: glBindVertexArray(vao_quad); break;
+				auto faces = load_sky(paths);
+				images.assign(std::make_move_iterator(faces.begin()), std::make_move_iterator(faces.end()));
 			}
-
-			auto const curr_mvp_inv = camera_projection * camera_view * object.model;
-
-			set_uniform(vert_shader_g, uniform_modl, object.model);
-			set_uniform(vert_shader_g, uniform_mvp, curr_mvp_inv);
-			set_uniform(vert_shader_g, uniform_mvp_inverse, object.mvp_inv_prev);
-			set_uniform(vert_shader_g, uniform_blur_except, object.except);
-
-			object.mvp_inv_prev = curr_mvp_inv;
-
-			for (auto const& object : objects)
+			else
 			{
-				switch (object.shape)
-				{
-				case shape_t::cube: glDrawElements(GL_TRIANGLES, indices_cube.size(), GL_UNSIGNED_BYTE, nullptr); break;
-				case shape_t::quad: glDrawElements(GL_TRIANGLES, indices_quad.size(), GL_UNSIGNED_BYTE, nullptr); break;
-				}
+				images.push_back(load_image(paths[0], comp));
 			}
 		}
+		catch (std::exception const& e)
+		{
+			std::clog << "failed to load asset: " << e.what() << '\n';
+			failed = true;
+		}
 
-		/* actual shading pass */
-		glClearNamedFramebufferfv(fb_finalcolor, GL_COLOR, 0, glm::value_ptr(glm::vec3(0.0f)));
-		glClearNamedFramebufferfv(fb_finalcolor, GL_DEPTH, 0, &depth_clear_val);
+		lock.lock();
+		auto& request = manager.requests[slot];
+		if (request.generation != generation || request.state == asset_state_t::cancelled)
+			continue;
+		request.state = failed ? asset_state_t::failed : asset_state_t::decoded;
+		request.images = std::move(images);
+	}
+}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, fb_finalcolor);
+std::unique_ptr<asset_manager_t> create_asset_manager(unsigned worker_count = 2)
+{
+	auto manager = std::make_unique<asset_manager_t>();
+
+	std::array<std::array<uint8_t, 4>, placeholder_count> colors = { {
+		{ 128, 128, 128, 255 },
+		{ 128, 128, 255, 255 },
+		{ 0, 0, 0, 255 }
+	} };
+	for (size_t i = 0; i < placeholder_count; i++)
+	{
+		manager->placeholders[i] = create_texture_2d(GL_RGBA8, GL_RGBA, 1, 1, colors[i].data());
+	}
+	auto const black = colors[size_t(placeholder_t::black)].data();
+	manager->placeholder_cube = create_texture_cube(GL_RGBA8, GL_RGBA, 1, 1, std::array<uint8_t const*, 6>{ black, black, black, black, black, black });
 
-		glBindTextureUnit(0, texture_gbuffer_position);
-		glBindTextureUnit(1, texture_gbuffer_normal);
-		glBindTextureUnit(2, texture_gbuffer_albedo);
-		glBindTextureUnit(3, texture_gbuffer_depth);
-		glBindTextureUnit(4, texture_skybox);
+	for (unsigned i = 0; i < worker_count; i++)
+	{
+		manager->workers.emplace_back(run_asset_worker, std::ref(*manager));
+	}
+	return manager;
+}
 
-		glBindProgramPipeline(pr);
-		glBindVertexArray(vao_empty);
+asset_handle_t request_asset(asset_manager_t& manager, std::vector<std::string> paths, bool cube, stb_comp_t comp, placeholder_t placeholder, float priority)
+{
+	auto key = cube ? std::string("cube") : std::to_string(int(comp));
+	for (auto const& path : paths)
+	{
+		key += '\n' + path;
+	}
 
-		set_uniform(frag_shader, uniform_cam_pos, camera_position);
-		set_uniform(vert_shader, uniform_cam_dir, glm::inverse(glm::mat3(camera_view)));
-		set_uniform(vert_shader, uniform_fov, fov);
-		set_uniform(vert_shader, uniform_aspect, float(viewport_width) / float(viewport_height));
-		set_uniform(vert_shader, uniform_uvs_diff, glm::vec2(
-			float(viewport_width) / float(screen_width),
-			float(viewport_height) / float(screen_height)
-		));
+	std::lock_guard<std::mutex> lock(manager.mutex);
+	auto const existing = manager.handles.find(key);
+	if (existing != manager.handles.end())
+	{
+		auto& request = *find_asset_request(manager, existing->second);
+		request.references++;
+		request.priority = std::max(request.priority, priority);
+		return existing->second;
+	}
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+	auto slot = manager.requests.size();
+	if (!manager.free_slots.empty())
+	{
+		slot = manager.free_slots.back();
+		manager.free_slots.pop_back();
+	}
+	else
+	{
+		manager.requests.emplace_back();
+	}
+	auto& request = manager.requests[slot];
+	request = { key, std::move(paths), cube, comp, placeholder, priority, 1, asset_state_t::queued, {}, 0, request.generation + 1 };
+	auto const handle = make_asset_handle(slot, request.generation);
+	manager.handles.emplace(std::move(key), handle);
+	manager.wake.notify_one();
+	return handle;
+}
 
-		/* motion blur */
+/* may be called from any thread */
+asset_handle_t load_texture_async(asset_manager_t& manager, std::string const& path, stb_comp_t comp, float priority, placeholder_t placeholder = placeholder_t::grey)
+{
+	return request_asset(manager, { path }, false, comp, placeholder, priority);
+}
 
-		glClearNamedFramebufferfv(fb_blur, GL_COLOR, 0, glm::value_ptr(glm::vec3(0.0f)));
-		
-		glBindFramebuffer(GL_FRAMEBUFFER, fb_blur);
+asset_handle_t load_sky_async(asset_manager_t& manager, std::string const& sky, float priority)
+{
+	return request_asset(manager, sky_paths(sky), true, STBI_rgb, placeholder_t::black, priority);
+}
 
-		glBindTextureUnit(0, texture_gbuffer_color);
-		glBindTextureUnit(1, texture_gbuffer_velocity);
-		
-		glBindProgramPipeline(pr_blur);
-		glBindVertexArray(vao_empty);
+/* for example by camera distance, only matters until the decode started */
+void set_asset_priority(asset_manager_t& manager, asset_handle_t handle, float priority)
+{
+	std::lock_guard<std::mutex> lock(manager.mutex);
+	if (auto const request = find_asset_request(manager, handle))
+		request->priority = priority;
+}
 
-		set_uniform(frag_shader_blur, uniform_blur_bias, 2.0f/*float(fps_sum) / float(60)*/);
-		set_uniform(vert_shader_blur, uniform_uvs_diff, glm::vec2(
-			float(viewport_width) / float(screen_width),
-			float(viewport_height) / float(screen_height)
-		));
+/* drops one reference, the request is cancelled (or its texture deleted) once nobody holds it, and
+   its slot is free for the next request. a worker still decoding it drops the result. context thread only */
+void cancel_asset(asset_manager_t& manager, asset_handle_t handle)
+{
+	std::lock_guard<std::mutex> lock(manager.mutex);
+	auto const request = find_asset_request(manager, handle);
+	if (!request || --request->references > 0)
+		return;
+
+	manager.handles.erase(request->key);
+	if (request->texture)
+		delete_textures({ request->texture });
+	*request = { {}, {}, false, STBI_default, placeholder_t::grey, 0.0f, 0, asset_state_t::cancelled, {}, 0, request->generation };
+	manager.free_slots.push_back(size_t(request - manager.requests.data()));
+}
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+/* the texture to bind, the placeholder until the real one is resident */
+GLuint asset_texture(asset_manager_t& manager, asset_handle_t handle)
+{
+	std::lock_guard<std::mutex> lock(manager.mutex);
+	auto const request = find_asset_request(manager, handle);
+	if (!request)
+		return manager.placeholders[size_t(placeholder_t::grey)];
+	if (request->texture)
+		return request->texture;
+	return request->cube ? manager.placeholder_cube : manager.placeholders[size_t(request->placeholder)];
+}
 
-		/* scale raster */
-		glViewport(0, 0, window_width, window_height);
+/* context thread, once per frame. uploads at most max_uploads decoded textures, most urgent first, so
+   a burst of finished decodes does not turn into a hitch */
+void update_asset_manager(asset_manager_t& manager, size_t max_uploads = 2)
+{
+	for (size_t upload = 0; upload < max_uploads; upload++)
+	{
+		std::vector<image_t> images;
+		auto slot = size_t(0);
+		auto cube = false;
+		{
+			std::lock_guard<std::mutex> lock(manager.mutex);
+			auto next = manager.requests.end();
+			for (auto request = manager.requests.begin(); request != manager.requests.end(); ++request)
+			{
+				if (request->state == asset_state_t::decoded && (next == manager.requests.end() || request->priority > next->priority))
+					next = request;
+			}
+			if (next == manager.requests.end())
+				return;
+			slot = size_t(next - manager.requests.begin());
+			cube = next->cube;
+			images = std::move(next->images);
+			next->images.clear();
+		}
+
+		trace_zone_t const zone("upload asset");
+		auto texture = GLuint(0);
+		if (cube)
+		{
+			std::array<image_t, 6> faces;
+			std::move(images.begin(), images.end(), faces.begin());
+			texture = create_texture_cube_from_images(faces);
+		}
+		else
+		{
+			texture = create_texture_2d_from_image(images[0]);
+		}
+
+		/* cancel_asset runs on this thread too, the request can not have gone away during the upload */
+		std::lock_guard<std::mutex> lock(manager.mutex);
+		manager.requests[slot].texture = texture;
+		manager.requests[slot].state = asset_state_t::resident;
+	}
+}
+
+/* points the shared textures (diffuse, specular, normal, skybox) at whatever is resident */
+void bind_asset_textures(asset_manager_t& manager, std::array<asset_handle_t, 4> const& handles, assets_t& assets)
+{
+	assets.texture_cube_diffuse = asset_texture(manager, handles[0]);
+	assets.texture_cube_specular = asset_texture(manager, handles[1]);
+	assets.texture_cube_normal = asset_texture(manager, handles[2]);
+	assets.texture_skybox = asset_texture(manager, handles[3]);
+}
+
+void delete_asset_manager(asset_manager_t& manager)
+{
+	{
+		std::lock_guard<std::mutex> lock(manager.mutex);
+		manager.quit = true;
+	}
+	manager.wake.notify_all();
+	for (auto& worker : manager.workers)
+	{
+		worker.join();
+	}
+
+	for (auto const& request : manager.requests)
+	{
+		if (request.texture)
+			delete_textures({ request.texture });
+	}
+	delete_textures({ manager.placeholders[0], manager.placeholders[1], manager.placeholders[2], manager.placeholder_cube });
+}
+
+inline GLuint create_vertex_array(GLuint vbo, GLuint ibo, std::vector<attrib_format_t> const& attrib_formats, GLsizei stride)
+{
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+	if (vbo)
+	{
+		glVertexArrayVertexBuffer(vao, 0, vbo, 0, stride);
+		glVertexArrayElementBuffer(vao, ibo);
+	}
+
+	for (auto const& format : attrib_formats)
+	{
+		glEnableVertexArrayAttrib(vao, format.attrib_index);
+		glVertexArrayAttribFormat(vao, format.attrib_index, format.size, format.type, GL_FALSE, format.relative_offset);
+		glVertexArrayAttribBinding(vao, format.attrib_index, 0);
+	}
+	return vao;
+}
+
+inline bool has_extension(std::string_view name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (auto i = 0; i < count; i++)
+	{
+		if (name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)))
+			return true;
+	}
+	return false;
+}
+
+/* pipeline statistics queries are only core since 4.6, the 4.5 loader lacks their tokens */
+#ifndef GL_VERTICES_SUBMITTED_ARB
+#define GL_VERTICES_SUBMITTED_ARB				0x82EE
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB		0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB		0x82F4
+#define GL_COMPUTE_SHADER_INVOCATIONS_ARB		0x82F5
+#define GL_CLIPPING_INPUT_PRIMITIVES_ARB		0x82F6
+#define GL_CLIPPING_OUTPUT_PRIMITIVES_ARB		0x82F7
+#endif
+
+enum struct pass_t
+{
+	gbuffer = 0,
+	shading = 1,
+	blur = 2
+};
+constexpr size_t pass_count = 3;
+constexpr std::array<const char*, pass_count> pass_names = { "gbuffer", "shading", "blur" };
+
+struct pipeline_statistic_t
+{
+	GLenum target;
+	const char* name;
+};
+
+constexpr std::array<pipeline_statistic_t, 6> pipeline_statistics =
+{{
+	{ GL_VERTICES_SUBMITTED_ARB, "vertices" },
+	{ GL_VERTEX_SHADER_INVOCATIONS_ARB, "vs invocations" },
+	{ GL_CLIPPING_INPUT_PRIMITIVES_ARB, "clip in" },
+	{ GL_CLIPPING_OUTPUT_PRIMITIVES_ARB, "clip out" },
+	{ GL_FRAGMENT_SHADER_INVOCATIONS_ARB, "fs invocations" },
+	{ GL_COMPUTE_SHADER_INVOCATIONS_ARB, "cs invocations" },
+}};
+constexpr size_t statistic_count = pipeline_statistics.size();
+
+/* gpu time and pipeline statistics of one pass, summed over every frame collected since the last reset */
+struct pass_totals_t
+{
+	uint64_t time_ns = 0;
+	std::array<uint64_t, statistic_count> statistics = {};
+	int64_t frames = 0;
+};
+
+/* maps gl timestamps onto trace time. both clocks are sampled every so often and the rate is fit
+   between the oldest and the newest sample, which follows the drift between them */
+constexpr size_t gpu_clock_samples = 8;
+constexpr int64_t gpu_clock_interval_us = 500000;
+
+struct gpu_clock_sample_t
+{
+	int64_t gpu_ns;
+	int64_t cpu_us;
+};
+
+struct gpu_clock_t
+{
+	std::array<gpu_clock_sample_t, gpu_clock_samples> samples = {};
+	size_t count = 0;
+	/* trace microseconds per gpu nanosecond */
+	double rate = 1e-3;
+};
+
+inline gpu_clock_sample_t const& newest_gpu_clock_sample(gpu_clock_t const& clock)
+{
+	return clock.samples[(clock.count - 1) % gpu_clock_samples];
+}
+
+/* the timestamp is taken once the previous commands reached the gpu, not after they ran,
+   so it does not wait on the frame in flight */
+void sample_gpu_clock(gpu_clock_t& clock)
+{
+	auto const before = trace_time_us();
+	GLint64 gpu_ns = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+	auto const after = trace_time_us();
+
+	clock.samples[clock.count % gpu_clock_samples] = { gpu_ns, (before + after) / 2 };
+	clock.count++;
+	if (clock.count < 2)
+		return;
+
+	auto const& newest = newest_gpu_clock_sample(clock);
+	auto const& oldest = clock.samples[clock.count > gpu_clock_samples ? clock.count % gpu_clock_samples : 0];
+	if (newest.gpu_ns > oldest.gpu_ns)
+		clock.rate = glm::clamp(double(newest.cpu_us - oldest.cpu_us) / double(newest.gpu_ns - oldest.gpu_ns), 0.9e-3, 1.1e-3);
+}
+
+inline int64_t gpu_to_trace_time(gpu_clock_t const& clock, int64_t gpu_ns)
+{
+	auto const& newest = newest_gpu_clock_sample(clock);
+	return newest.cpu_us + int64_t(std::llround(double(gpu_ns - newest.gpu_ns) * clock.rate));
+}
+
+/* timer and statistics queries of the last few frames, polled without waiting.
+   a frame whose query slot is still in flight is not measured rather than stalling on it */
+struct gpu_profiler_t
+{
+	static constexpr size_t latency = 4;
+
+	struct frame_t
+	{
+		std::array<GLuint, pass_count> timers = {};
+		std::array<std::array<GLuint, statistic_count>, pass_count> statistics = {};
+		/* begin and end timestamps of each pass, only issued while tracing */
+		std::array<std::array<GLuint, 2>, pass_count> timestamps = {};
+		bool traced = false;
+		bool pending = false;
+		bool discard = false;
+	};
+
+	std::array<frame_t, latency> frames;
+	size_t current = 0;
+	size_t active_pass = 0;
+	bool recording = false;
+	bool statistics_supported = false;
+	gpu_clock_t clock;
+
+	std::array<pass_totals_t, pass_count> totals;
+	int64_t skipped = 0;
+};
+
+std::unique_ptr<gpu_profiler_t> create_gpu_profiler()
+{
+	auto profiler = std::make_unique<gpu_profiler_t>();
+	profiler->statistics_supported = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 6) || has_extension("GL_ARB_pipeline_statistics_query");
+	if (!profiler->statistics_supported)
+		std::clog << "pipeline statistics queries not available, only timing passes\n";
+
+	for (auto& frame : profiler->frames)
+	{
+		glCreateQueries(GL_TIME_ELAPSED, GLsizei(pass_count), frame.timers.data());
+		for (auto& timestamps : frame.timestamps)
+		{
+			glCreateQueries(GL_TIMESTAMP, 2, timestamps.data());
+		}
+		if (!profiler->statistics_supported)
+			continue;
+
+		for (auto& statistics : frame.statistics)
+		{
+			for (size_t s = 0; s < statistic_count; s++)
+			{
+				glCreateQueries(pipeline_statistics[s].target, 1, &statistics[s]);
+			}
+		}
+	}
+	return profiler;
+}
+
+void delete_gpu_profiler(gpu_profiler_t const& profiler)
+{
+	for (auto const& frame : profiler.frames)
+	{
+		glDeleteQueries(GLsizei(pass_count), frame.timers.data());
+		for (auto const& timestamps : frame.timestamps)
+		{
+			glDeleteQueries(2, timestamps.data());
+		}
+		for (auto const& statistics : frame.statistics)
+		{
+			glDeleteQueries(GLsizei(statistic_count), statistics.data());
+		}
+	}
+}
+
+inline bool query_available(GLuint query)
+{
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	return available == GL_TRUE;
+}
+
+/* folds every finished frame into the totals, oldest first */
+void collect_gpu_profiler(gpu_profiler_t& profiler)
+{
+	for (size_t i = 0; i < gpu_profiler_t::latency; i++)
+	{
+		auto& frame = profiler.frames[(profiler.current + i) % gpu_profiler_t::latency];
+		if (!frame.pending)
+			continue;
+
+		auto available = true;
+		for (size_t pass = 0; pass < pass_count && available; pass++)
+		{
+			available = query_available(frame.timers[pass]) && (!frame.traced || query_available(frame.timestamps[pass][1]));
+			for (size_t s = 0; s < statistic_count && available && profiler.statistics_supported; s++)
+			{
+				available = query_available(frame.statistics[pass][s]);
+			}
+		}
+		if (!available)
+			break;
+
+		for (size_t pass = 0; pass < pass_count && !frame.discard; pass++)
+		{
+			auto& totals = profiler.totals[pass];
+			GLuint64 value = 0;
+			glGetQueryObjectui64v(frame.timers[pass], GL_QUERY_RESULT, &value);
+			totals.time_ns += value;
+			if (frame.traced && trace_active())
+			{
+				GLuint64 begin_ns = 0, end_ns = 0;
+				glGetQueryObjectui64v(frame.timestamps[pass][0], GL_QUERY_RESULT, &begin_ns);
+				glGetQueryObjectui64v(frame.timestamps[pass][1], GL_QUERY_RESULT, &end_ns);
+				record_trace_event({ pass_names[pass], trace_phase_t::zone, gpu_to_trace_time(profiler.clock, int64_t(begin_ns)), gpu_to_trace_time(profiler.clock, int64_t(end_ns)), trace_gpu_thread });
+			}
+			for (size_t s = 0; s < statistic_count && profiler.statistics_supported; s++)
+			{
+				glGetQueryObjectui64v(frame.statistics[pass][s], GL_QUERY_RESULT, &value);
+				totals.statistics[s] += value;
+			}
+			totals.frames++;
+		}
+		frame.pending = false;
+		frame.discard = false;
+	}
+}
+
+/* drops the totals, and whatever is still in flight from before */
+void reset_gpu_profiler(gpu_profiler_t& profiler)
+{
+	profiler.totals = {};
+	profiler.skipped = 0;
+	for (auto& frame : profiler.frames)
+	{
+		frame.discard = frame.pending;
+	}
+}
+
+void begin_gpu_frame(gpu_profiler_t* profiler)
+{
+	if (!profiler)
+		return;
+
+	collect_gpu_profiler(*profiler);
+	auto& frame = profiler->frames[profiler->current];
+	profiler->recording = !frame.pending;
+	if (!profiler->recording)
+	{
+		profiler->skipped++;
+		return;
+	}
+
+	/* timestamps are only worth their queries while someone traces */
+	frame.traced = trace_active();
+	if (frame.traced && (profiler->clock.count == 0 || trace_time_us() - newest_gpu_clock_sample(profiler->clock).cpu_us > gpu_clock_interval_us))
+		sample_gpu_clock(profiler->clock);
+}
+
+void end_gpu_frame(gpu_profiler_t* profiler)
+{
+	if (!profiler || !profiler->recording)
+		return;
+
+	profiler->frames[profiler->current].pending = true;
+	profiler->current = (profiler->current + 1) % gpu_profiler_t::latency;
+}
+
+void begin_gpu_pass(gpu_profiler_t* profiler, pass_t pass)
+{
+	if (!profiler || !profiler->recording)
+		return;
+
+	auto const& frame = profiler->frames[profiler->current];
+	profiler->active_pass = size_t(pass);
+	if (frame.traced)
+		glQueryCounter(frame.timestamps[size_t(pass)][0], GL_TIMESTAMP);
+	glBeginQuery(GL_TIME_ELAPSED, frame.timers[size_t(pass)]);
+	for (size_t s = 0; s < statistic_count && profiler->statistics_supported; s++)
+	{
+		glBeginQuery(pipeline_statistics[s].target, frame.statistics[size_t(pass)][s]);
+	}
+}
+
+void end_gpu_pass(gpu_profiler_t* profiler)
+{
+	if (!profiler || !profiler->recording)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	for (size_t s = 0; s < statistic_count && profiler->statistics_supported; s++)
+	{
+		glEndQuery(pipeline_statistics[s].target);
+	}
+
+	auto const& frame = profiler->frames[profiler->current];
+	if (frame.traced)
+		glQueryCounter(frame.timestamps[profiler->active_pass][1], GL_TIMESTAMP);
+}
+
+/* per frame averages of every pass and of the submission counters next to the cpu frame time */
+void print_benchmark(gpu_profiler_t const& profiler, counters_t const& counters, int64_t frames, double seconds)
+{
+	std::ostringstream report;
+	report << string_format("benchmark: %lld frames, %.3f ms/frame cpu, %.1f fps, %lld frames not measured on the gpu\n",
+		static_cast<long long>(frames), 1000.0 * seconds / double(frames), double(frames) / seconds, static_cast<long long>(profiler.skipped));
+
+	report << "per frame:";
+	for (size_t i = 0; i < counter_count; i++)
+	{
+		report << string_format(" %s = %.1f", counter_names[i], double(counters[i]) / double(frames));
+	}
+	report << '\n';
+
+	report << string_format("%-10s %10s", "pass", "gpu ms");
+	for (auto const& statistic : pipeline_statistics)
+	{
+		report << string_format(" %15s", statistic.name);
+	}
+	report << '\n';
+
+	for (size_t pass = 0; pass < pass_count; pass++)
+	{
+		auto const& totals = profiler.totals[pass];
+		auto const samples = double(std::max<int64_t>(totals.frames, 1));
+		report << string_format("%-10s %10.3f", pass_names[pass], double(totals.time_ns) / samples / 1e6);
+		for (size_t s = 0; s < statistic_count; s++)
+		{
+			if (profiler.statistics_supported)
+				report << string_format(" %15.0f", double(totals.statistics[s]) / samples);
+			else
+				report << string_format(" %15s", "n/a");
+		}
+		report << '\n';
+	}
+	std::cout << report.str();
+}
+
+/* what every metrics sink gets once per frame */
+struct frame_metrics_t
+{
+	int64_t frame;
+	double frame_ms;
+	counters_t counters;
+};
+
+/* csv file with one row per frame, buffered so writing stays off the gpu's way */
+struct metrics_sink_t
+{
+	std::ofstream file;
+};
+
+std::unique_ptr<metrics_sink_t> create_metrics_sink(std::string const& path)
+{
+	auto sink = std::make_unique<metrics_sink_t>();
+	sink->file.open(path, std::ios::trunc);
+	if (!sink->file)
+		throw std::runtime_error("can not write metrics to " + path);
+
+	sink->file << "frame,frame_ms";
+	for (auto const name : counter_names)
+	{
+		sink->file << ',' << name;
+	}
+	sink->file << '\n';
+	return sink;
+}
+
+void write_metrics(metrics_sink_t& sink, frame_metrics_t const& metrics)
+{
+	sink.file << metrics.frame << ',' << string_format("%.3f", metrics.frame_ms);
+	for (auto const value : metrics.counters)
+	{
+		sink.file << ',' << value;
+	}
+	sink.file << '\n';
+}
+
+/* wait-free handoff of the latest value from one writer to one reader. the writer fills its own
+   slot and swaps it into the middle, the reader swaps the middle out whenever something new is there */
+template<typename T>
+struct snapshot_buffer_t
+{
+	static constexpr uint32_t fresh = 4;
+
+	std::array<T, 3> slots;
+	std::atomic<uint32_t> middle = 1;
+	uint32_t back = 0;
+	uint32_t front = 2;
+};
+
+/* the writer overwrites all of it before every publish */
+template<typename T>
+inline T& snapshot_back(snapshot_buffer_t<T>& buffer)
+{
+	return buffer.slots[buffer.back];
+}
+
+template<typename T>
+inline void publish_snapshot(snapshot_buffer_t<T>& buffer)
+{
+	buffer.back = buffer.middle.exchange(buffer.back | snapshot_buffer_t<T>::fresh, std::memory_order_acq_rel) & 3;
+}
+
+template<typename T>
+inline T const& read_snapshot(snapshot_buffer_t<T>& buffer)
+{
+	if (buffer.middle.load(std::memory_order_relaxed) & snapshot_buffer_t<T>::fresh)
+		buffer.front = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel) & 3;
+	return buffer.slots[buffer.front];
+}
+
+/* everything the metrics endpoint serves, copied out by the render thread once per frame */
+constexpr size_t frame_time_history = 256;
+
+struct metrics_snapshot_t
+{
+	int64_t frame = 0;
+	std::array<float, frame_time_history> frame_ms = {};
+	size_t frame_ms_count = 0;
+	counters_t counters = {};
+	bool gpu_passes = false;
+	std::array<pass_totals_t, pass_count> passes = {};
+	uint64_t readback_in_flight = 0;
+};
+
+/* prometheus text exposition format */
+std::string format_metrics(metrics_snapshot_t const& snapshot)
+{
+	std::ostringstream text;
+	auto const metric = [&text](char const* name, char const* type, char const* help) {
+		text << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+	};
+
+	metric("renderer_frames_total", "counter", "Frames rendered.");
+	text << "renderer_frames_total " << snapshot.frame << '\n';
+
+	std::vector<float> frame_ms(snapshot.frame_ms.begin(), snapshot.frame_ms.begin() + snapshot.frame_ms_count);
+	std::sort(frame_ms.begin(), frame_ms.end());
+	metric("renderer_frame_time_milliseconds", "summary", "Frame time over the most recent frames.");
+	for (auto const quantile : { 0.5, 0.9, 0.99, 1.0 })
+	{
+		auto const value = frame_ms.empty() ? 0.0 : double(frame_ms[std::min(frame_ms.size() - 1, size_t(quantile * double(frame_ms.size())))]);
+		text << string_format("renderer_frame_time_milliseconds{quantile=\"%g\"} %.3f\n", quantile, value);
+	}
+	text << string_format("renderer_frame_time_milliseconds_sum %.3f\n", std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0));
+	text << "renderer_frame_time_milliseconds_count " << frame_ms.size() << '\n';
+
+	for (size_t i = 0; i < counter_count; i++)
+	{
+		auto const name = std::string("renderer_") + counter_names[i] + "_total";
+		metric(name.c_str(), "counter", "Submission counter summed over all threads.");
+		text << name << ' ' << snapshot.counters[i] << '\n';
+	}
+
+	if (snapshot.gpu_passes)
+	{
+		metric("renderer_gpu_pass_seconds_total", "counter", "GPU time spent in each pass.");
+		for (size_t pass = 0; pass < pass_count; pass++)
+		{
+			text << string_format("renderer_gpu_pass_seconds_total{pass=\"%s\"} %.9f\n", pass_names[pass], double(snapshot.passes[pass].time_ns) / 1e9);
+		}
+		metric("renderer_gpu_pass_frames_total", "counter", "Frames whose GPU pass timings were collected.");
+		for (size_t pass = 0; pass < pass_count; pass++)
+		{
+			text << string_format("renderer_gpu_pass_frames_total{pass=\"%s\"} %lld\n", pass_names[pass], static_cast<long long>(snapshot.passes[pass].frames));
+		}
+	}
+
+	metric("renderer_readback_in_flight", "gauge", "Asynchronous readbacks waiting on the GPU.");
+	text << "renderer_readback_in_flight " << snapshot.readback_in_flight << '\n';
+	return text.str();
+}
+
+/* overdraw measurement: the g-buffer pass counts fragments and quad helper lanes per pixel,
+   a compute pass reduces them, and a heatmap replaces the final image */
+constexpr size_t overdraw_bins = 16;
+constexpr GLuint overdraw_heatmap_max = 8;
+constexpr auto uniform_heatmap_max = 0;
+
+/* std430 layout of the result block in overdraw.comp */
+struct overdraw_stats_t
+{
+	GLuint pixels;
+	GLuint fragments;
+	GLuint helpers;
+	GLuint max;
+	std::array<GLuint, overdraw_bins> histogram;
+};
+
+struct overdraw_t
+{
+	GLsizei width, height;
+	GLuint texture_fragments, texture_helpers;
+	GLuint ssbo_stats;
+	GLuint frag_shader_g, pr_g;
+	GLuint comp_shader, pr_reduce;
+	GLuint frag_shader_heatmap, pr_heatmap;
+};
+
+/* the g-buffer and heatmap pipelines reuse the renderer's vertex stages */
+std::unique_ptr<overdraw_t> create_overdraw(GLuint vert_shader_g, GLuint vert_shader_blur, GLsizei width, GLsizei height)
+{
+	auto overdraw = std::make_unique<overdraw_t>();
+	overdraw->width = width;
+	overdraw->height = height;
+	overdraw->texture_fragments = create_texture_2d(GL_R32UI, GL_RED_INTEGER, width, height, nullptr, GL_NEAREST);
+	overdraw->texture_helpers = create_texture_2d(GL_R32UI, GL_RED_INTEGER, width, height, nullptr, GL_NEAREST);
+
+	glCreateBuffers(1, &overdraw->ssbo_stats);
+	glNamedBufferStorage(overdraw->ssbo_stats, sizeof(overdraw_stats_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	track_buffer(overdraw->ssbo_stats, sizeof(overdraw_stats_t));
+
+	overdraw->frag_shader_g = create_shader_stage(GL_FRAGMENT_SHADER, "./shaders/gbuffer.frag", "#define OVERDRAW\n");
+	glCreateProgramPipelines(1, &overdraw->pr_g);
+	glUseProgramStages(overdraw->pr_g, GL_VERTEX_SHADER_BIT, vert_shader_g);
+	glUseProgramStages(overdraw->pr_g, GL_FRAGMENT_SHADER_BIT, overdraw->frag_shader_g);
+
+	overdraw->comp_shader = create_shader_stage(GL_COMPUTE_SHADER, "./shaders/overdraw.comp");
+	glCreateProgramPipelines(1, &overdraw->pr_reduce);
+	glUseProgramStages(overdraw->pr_reduce, GL_COMPUTE_SHADER_BIT, overdraw->comp_shader);
+
+	overdraw->frag_shader_heatmap = create_shader_stage(GL_FRAGMENT_SHADER, "./shaders/overdraw.frag");
+	glCreateProgramPipelines(1, &overdraw->pr_heatmap);
+	glUseProgramStages(overdraw->pr_heatmap, GL_VERTEX_SHADER_BIT, vert_shader_blur);
+	glUseProgramStages(overdraw->pr_heatmap, GL_FRAGMENT_SHADER_BIT, overdraw->frag_shader_heatmap);
+	set_uniform(overdraw->frag_shader_heatmap, uniform_heatmap_max, overdraw_heatmap_max);
+
+	return overdraw;
+}
+
+void delete_overdraw(overdraw_t const& overdraw)
+{
+	delete_textures({ overdraw.texture_fragments, overdraw.texture_helpers });
+	delete_buffers({ overdraw.ssbo_stats });
+	delete_items(glDeleteProgram, { overdraw.frag_shader_g, overdraw.comp_shader, overdraw.frag_shader_heatmap });
+	delete_items(glDeleteProgramPipelines, { overdraw.pr_g, overdraw.pr_reduce, overdraw.pr_heatmap });
+}
+
+void clear_overdraw(overdraw_t const& overdraw)
+{
+	auto const zero = GLuint(0);
+	glClearTexImage(overdraw.texture_fragments, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glClearTexImage(overdraw.texture_helpers, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindImageTexture(0, overdraw.texture_fragments, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+	glBindImageTexture(1, overdraw.texture_helpers, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+}
+
+/* after the g-buffer pass: averages, maximum and histogram end up in ssbo_stats */
+void reduce_overdraw(overdraw_t const& overdraw)
+{
+	auto const zero = GLuint(0);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	glClearNamedBufferData(overdraw.ssbo_stats, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	bind_program_pipeline(overdraw.pr_reduce);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, overdraw.ssbo_stats);
+	glDispatchCompute(GLuint(overdraw.width + 15) / 16, GLuint(overdraw.height + 15) / 16, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void draw_overdraw_heatmap(overdraw_t const& overdraw, GLuint vert_shader_blur, GLuint vao_empty)
+{
+	glViewport(0, 0, overdraw.width, overdraw.height);
+	bind_texture_unit(0, overdraw.texture_fragments);
+
+	bind_program_pipeline(overdraw.pr_heatmap);
+	glBindVertexArray(vao_empty);
+	set_uniform(vert_shader_blur, uniform_uvs_offset, glm::vec2(0.0f));
+	set_uniform(vert_shader_blur, uniform_uvs_diff, glm::vec2(1.0f));
+	draw_triangles(6, 1);
+}
+
+/* limits of the per frame uniform storage */
+constexpr size_t max_views = 4;
+constexpr size_t max_objects = 1024;
+
+/* stereo renders both eyes as layers of array targets */
+constexpr GLsizei max_layers = 2;
+
+/* std140 layout of the view block in gbuffer.vert */
+struct view_uniforms_t
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 view_projection_prev;
+};
+
+/* std430 layout of one element of the object block in gbuffer.vert */
+struct object_uniforms_t
+{
+	glm::mat4 model;
+	glm::mat4 model_prev;
+	GLuint id;
+	GLuint except;
+	/* std430 rounds the struct up to the alignment of its mat4 */
+	GLuint padding[2] = {};
+};
+
+/* everything one renderer instance owns: render targets, and the container objects
+   (vertex arrays, framebuffers, pipelines) that can not be shared between contexts.
+   programs are per instance too, since their uniforms are set per draw */
+struct renderer_t
+{
+	GLsizei width, height, layers;
+	bool object_ids;
+
+	GLuint texture_gbuffer_color;
+	GLuint texture_gbuffer_position;
+	GLuint texture_gbuffer_normal;
+	GLuint texture_gbuffer_albedo;
+	GLuint texture_gbuffer_depth;
+	GLuint texture_gbuffer_velocity;
+	GLuint texture_gbuffer_id;
+	GLuint texture_motion_blur;
+	GLuint texture_motion_blur_mask;
+
+	GLuint fb_gbuffer, fb_finalcolor, fb_blur;
+	GLuint vao_empty, vao_cube, vao_quad;
+
+	/* what gets presented and read back: fb_blur in mono, the eyes side by side in stereo */
+	GLuint texture_output, fb_output;
+	std::array<GLuint, max_layers> fb_eyes;
+
+	GLuint pr, vert_shader, frag_shader;
+	GLuint pr_g, vert_shader_g, frag_shader_g;
+	GLuint pr_blur, vert_shader_blur, frag_shader_blur;
+
+	/* per frame uniform storage, the view blocks (one per layer) sit at view_stride apart */
+	GLuint ubo_views, ssbo_objects;
+	GLsizeiptr view_stride;
+
+	/* scratch reused from frame to frame */
+	std::vector<draw_t> draws;
+	std::vector<object_uniforms_t> object_uniforms;
+
+	/* optional, passes are only measured while it exists */
+	std::unique_ptr<gpu_profiler_t> profiler;
+	/* optional, replaces the final image by an overdraw heatmap */
+	std::unique_ptr<overdraw_t> overdraw;
+};
+
+/* everything but the programs, width and height are per layer, layers is 2 for stereo */
+renderer_t create_renderer_targets(assets_t const& assets, GLsizei width, GLsizei height, bool object_ids, GLsizei layers)
+{
+	if (layers < 1 || layers > max_layers)
+		throw std::runtime_error("unsupported layer count");
+	if (layers > 1 && !has_extension("GL_ARB_shader_viewport_layer_array"))
+		throw std::runtime_error("stereo rendering needs GL_ARB_shader_viewport_layer_array");
+
+	renderer_t renderer;
+	renderer.width = width;
+	renderer.height = height;
+	renderer.layers = layers;
+	renderer.object_ids = object_ids;
+
+	/* context state */
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	/* framebuffer textures, arrays attach layered */
+	auto const create_target = [width, height, layers](GLenum internal_format, GLenum format) {
+		return layers > 1
+			? create_texture_2d_array(internal_format, width, height, layers, GL_NEAREST)
+			: create_texture_2d(internal_format, format, width, height, nullptr, GL_NEAREST);
+	};
+	renderer.texture_gbuffer_color = create_target(GL_RGB8, GL_RGB);
+	renderer.texture_gbuffer_position = create_target(GL_RGB16F, GL_RGB);
+	renderer.texture_gbuffer_normal = create_target(GL_RGB16F, GL_RGB);
+	renderer.texture_gbuffer_albedo = create_target(GL_RGBA16F, GL_RGBA);
+	renderer.texture_gbuffer_depth = create_target(GL_DEPTH_COMPONENT32, GL_DEPTH);
+	renderer.texture_gbuffer_velocity = create_target(GL_RG16F, GL_RG);
+	renderer.texture_gbuffer_id = object_ids ? create_target(GL_R32UI, GL_RED_INTEGER) : 0;
+	renderer.texture_motion_blur = create_target(GL_RGB8, GL_RGB);
+	renderer.texture_motion_blur_mask = create_target(GL_R8, GL_RED);
+
+	renderer.fb_gbuffer = object_ids
+		? create_framebuffer({ renderer.texture_gbuffer_position, renderer.texture_gbuffer_normal, renderer.texture_gbuffer_albedo, renderer.texture_gbuffer_velocity, renderer.texture_gbuffer_id }, renderer.texture_gbuffer_depth)
+		: create_framebuffer({ renderer.texture_gbuffer_position, renderer.texture_gbuffer_normal, renderer.texture_gbuffer_albedo, renderer.texture_gbuffer_velocity }, renderer.texture_gbuffer_depth);
+	renderer.fb_finalcolor = create_framebuffer({ renderer.texture_gbuffer_color });
+	renderer.fb_blur = create_framebuffer({ renderer.texture_motion_blur });
+
+	renderer.texture_output = 0;
+	renderer.fb_output = renderer.fb_blur;
+	renderer.fb_eyes = {};
+	if (layers > 1)
+	{
+		renderer.texture_output = create_texture_2d(GL_RGB8, GL_RGB, width * layers, height, nullptr, GL_NEAREST);
+		renderer.fb_output = create_framebuffer({ renderer.texture_output });
+		for (auto layer = 0; layer < layers; layer++)
+		{
+			glCreateFramebuffers(1, &renderer.fb_eyes[layer]);
+			glNamedFramebufferTextureLayer(renderer.fb_eyes[layer], GL_COLOR_ATTACHMENT0, renderer.texture_motion_blur, 0, layer);
+			glNamedFramebufferReadBuffer(renderer.fb_eyes[layer], GL_COLOR_ATTACHMENT0);
+		}
+	}
+
+	/* geometry buffers */
+	renderer.vao_empty = create_vertex_array(0, 0, {}, 0);
+	renderer.vao_cube = create_vertex_array(assets.vbo_cube, assets.ibo_cube, vertex_format, sizeof(vertex_t));
+	renderer.vao_quad = create_vertex_array(assets.vbo_quad, assets.ibo_quad, vertex_format, sizeof(vertex_t));
+
+	/* uniform storage */
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	renderer.view_stride = (GLsizeiptr(sizeof(view_uniforms_t) * layers) + alignment - 1) / alignment * alignment;
+	glCreateBuffers(1, &renderer.ubo_views);
+	glNamedBufferStorage(renderer.ubo_views, renderer.view_stride * max_views, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	track_buffer(renderer.ubo_views, size_t(renderer.view_stride) * max_views);
+	glCreateBuffers(1, &renderer.ssbo_objects);
+	glNamedBufferStorage(renderer.ssbo_objects, sizeof(object_uniforms_t) * max_objects, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	track_buffer(renderer.ssbo_objects, sizeof(object_uniforms_t) * max_objects);
+	renderer.draws.reserve(max_objects);
+	renderer.object_uniforms.reserve(max_objects);
+
+	return renderer;
+}
+
+/* adds creating a renderer to a startup graph, after the given asset tasks. shader sources are read
+   on workers and compiled on the context thread without waiting for the assets, so compiles overlap
+   the texture decodes */
+size_t add_renderer_tasks(task_graph_t& graph, renderer_t& renderer, assets_t const& assets, std::vector<size_t> const& dependencies, GLsizei width, GLsizei height, bool object_ids, GLsizei layers = 1)
+{
+	auto const targets = add_task(graph, "render targets", task_queue_t::context, [&renderer, &assets, width, height, object_ids, layers]() {
+		renderer = create_renderer_targets(assets, width, height, object_ids, layers);
+	}, dependencies);
+
+	auto const defines = layers > 1 ? "#define STEREO\n" : "";
+	auto const programs = std::make_shared<std::array<std::tuple<GLuint, GLuint, GLuint>, 3>>();
+	auto const add_program = [&graph, programs, defines](size_t index, char const* vert_filepath, char const* frag_filepath) {
+		auto const source = std::make_shared<program_source_t>();
+		auto const read = add_task(graph, "read shader sources", task_queue_t::worker, [source, vert_filepath, frag_filepath, defines]() {
+			*source = read_program_source(vert_filepath, frag_filepath, defines);
+		});
+		return add_task(graph, "compile program", task_queue_t::context, [source, programs, index]() {
+			(*programs)[index] = create_program(*source);
+		}, { read });
+	};
+
+	return add_task(graph, "renderer", task_queue_t::context, [&renderer, programs]() {
+		std::tie(renderer.pr, renderer.vert_shader, renderer.frag_shader) = (*programs)[0];
+		std::tie(renderer.pr_g, renderer.vert_shader_g, renderer.frag_shader_g) = (*programs)[1];
+		std::tie(renderer.pr_blur, renderer.vert_shader_blur, renderer.frag_shader_blur) = (*programs)[2];
+	}, {
+		targets,
+		add_program(0, "./shaders/main.vert", "./shaders/main.frag"),
+		add_program(1, "./shaders/gbuffer.vert", "./shaders/gbuffer.frag"),
+		add_program(2, "./shaders/blur.vert", "./shaders/blur.frag")
+	});
+}
+
+renderer_t create_renderer(assets_t const& assets, GLsizei width, GLsizei height, bool object_ids, GLsizei layers = 1)
+{
+	task_graph_t graph;
+	renderer_t renderer;
+	add_renderer_tasks(graph, renderer, assets, {}, width, height, object_ids, layers);
+	run_task_graph(graph);
+	return renderer;
+}
+
+void delete_renderer(renderer_t const& renderer)
+{
+	delete_textures(
+		{
+		renderer.texture_gbuffer_position,
+		renderer.texture_gbuffer_albedo,
+		renderer.texture_gbuffer_normal,
+		renderer.texture_gbuffer_depth,
+		renderer.texture_gbuffer_velocity,
+		renderer.texture_gbuffer_color,
+		renderer.texture_gbuffer_id,
+
+		renderer.texture_motion_blur,
+		renderer.texture_motion_blur_mask,
+		renderer.texture_output
+		});
+	delete_items(glDeleteProgram, {
+		renderer.vert_shader,
+		renderer.frag_shader,
+
+		renderer.vert_shader_g,
+		renderer.frag_shader_g,
+
+		renderer.vert_shader_blur,
+		renderer.frag_shader_blur,
+		});
+
+	delete_items(glDeleteProgramPipelines, { renderer.pr, renderer.pr_g, renderer.pr_blur });
+	delete_items(glDeleteVertexArrays, { renderer.vao_cube, renderer.vao_quad, renderer.vao_empty });
+	delete_items(glDeleteFramebuffers, { renderer.fb_gbuffer, renderer.fb_finalcolor, renderer.fb_blur });
+	if (renderer.fb_output != renderer.fb_blur)
+	{
+		delete_items(glDeleteFramebuffers, { renderer.fb_output, renderer.fb_eyes[0], renderer.fb_eyes[1] });
+	}
+	delete_buffers({ renderer.ubo_views, renderer.ssbo_objects });
+	if (renderer.profiler)
+	{
+		delete_gpu_profiler(*renderer.profiler);
+	}
+	if (renderer.overdraw)
+	{
+		delete_overdraw(*renderer.overdraw);
+	}
+}
+
+template<typename Keys>
+void apply_input(scene_t& scene, Keys const& key)
+{
+	auto& camera = scene.cameras[0];
+	auto const camera_forward = camera.orientation * glm::vec3(0.0f, 0.0f, 1.0f);
+	auto const camera_right = camera.orientation * glm::vec3(1.0f, 0.0f, 0.0f);
+
+	if (key[SDL_SCANCODE_LEFT])		camera.rot_y += 0.025f;
+	if (key[SDL_SCANCODE_RIGHT])	camera.rot_y -= 0.025f;
+	if (key[SDL_SCANCODE_UP])		camera.rot_x -= 0.025f;
+	if (key[SDL_SCANCODE_DOWN])		camera.rot_x += 0.025f;
+
+	camera.orientation = glm::quat(glm::vec3(camera.rot_x, camera.rot_y, 0.0f));
+
+	if (key[SDL_SCANCODE_W]) camera.position += camera_forward * 0.1f;
+	if (key[SDL_SCANCODE_A]) camera.position += camera_right * 0.1f;
+	if (key[SDL_SCANCODE_S]) camera.position -= camera_forward * 0.1f;
+	if (key[SDL_SCANCODE_D]) camera.position -= camera_right * 0.1f;
+
+	if (key[SDL_SCANCODE_Q]) scene.cube_speed -= 0.01f;
+	if (key[SDL_SCANCODE_E]) scene.cube_speed += 0.01f;
+}
+
+/* one camera rendered into a rectangle of the renderer's targets */
+struct view_t
+{
+	size_t camera;
+	glm::ivec4 rect;
+	glm::mat4 projection;
+	std::array<glm::mat4, max_layers> view_projection_prev;
+	glm::vec4 tile = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	float aspect;
+};
+
+/* lays out count views in a grid over the target, the first one at the top left.
+   aspect is the one the whole target is displayed at */
+std::vector<view_t> create_views(scene_t const& scene, int count, GLsizei width, GLsizei height, float aspect)
+{
+	if (count < 1 || size_t(count) > max_views)
+		throw std::runtime_error(string_format("view count must be between 1 and %d", int(max_views)));
+
+	auto const columns = count == 1 ? 1 : 2;
+	auto const rows = count > 2 ? 2 : 1;
+	std::vector<view_t> views(count);
+	for (auto i = 0; i < count; i++)
+	{
+		auto const column = i % columns;
+		auto const row = rows - 1 - i / columns;
+		auto const x0 = column * width / columns, x1 = (column + 1) * width / columns;
+		auto const y0 = row * height / rows, y1 = (row + 1) * height / rows;
+
+		auto& view = views[i];
+		view.camera = size_t(i) % scene.cameras.size();
+		view.rect = glm::ivec4(x0, y0, x1 - x0, y1 - y0);
+		view.aspect = aspect * (float(rows) / float(columns));
+		view.projection = glm::perspective(scene.cameras[view.camera].fov, view.aspect, 0.1f, 1000.0f);
+	}
+	return views;
+}
+
+struct frame_params_t
+{
+	std::vector<view_t> views;
+	float vel_scale = 2.0f;
+	float eye_separation = 0.064f;
+	std::array<bool, pass_count> passes = { true, true, true };
+
+	/* the views cover extent, the resolution scale of the renderer's targets */
+	float resolution_scale = 1.0f;
+	float aspect = 1.0f;
+	glm::ivec2 extent = glm::ivec2(0);
+
+	/* while a sky switch fades in, the sky it replaces */
+	GLuint sky_previous = 0;
+	float sky_fade = 1.0f;
+};
+
+/* (re)creates the views over the scaled extent, keeping their history when the count stays */
+void layout_views(frame_params_t& params, scene_t const& scene, renderer_t const& renderer, int count)
+{
+	params.extent = glm::max(glm::ivec2(glm::vec2(renderer.width, renderer.height) * params.resolution_scale), glm::ivec2(1));
+	auto views = create_views(scene, count, params.extent.x, params.extent.y, params.aspect);
+	if (views.size() == params.views.size())
+	{
+		for (size_t v = 0; v < views.size(); v++)
+			views[v].view_projection_prev = params.views[v].view_projection_prev;
+	}
+	params.views = std::move(views);
+}
+
+/* view matrix of one layer, stereo eyes sit half the separation left and right of the camera */
+inline glm::mat4 eye_view(glm::mat4 const& camera_view, GLsizei layer, GLsizei layers, float eye_separation)
+{
+	if (layers == 1)
+		return camera_view;
+	auto const offset = (layer == 0 ? 0.5f : -0.5f) * eye_separation;
+	return glm::translate(glm::vec3(offset, 0.0f, 0.0f)) * camera_view;
+}
+
+/* renders the scene into the renderer's targets, the result ends up in fb_output.
+   culling and sorting run once for all views, every view then draws its subset into its own rect.
+   in stereo every draw is instanced once per eye and routed to its layer by the vertex shader */
+void render_frame(renderer_t& renderer, assets_t const& assets, scene_t& scene, frame_params_t& params)
+{
+	auto& views = params.views;
+	auto& objects = scene.objects;
+	if (views.size() > max_views || objects.size() > max_objects)
+		throw std::runtime_error("too many views or objects for one frame");
+
+	auto const screen_width = renderer.width;
+	auto const screen_height = renderer.height;
+
+	auto const layers = renderer.layers;
+	auto const profiler = renderer.profiler.get();
+	auto const enabled = [&params](pass_t pass) { return params.passes[size_t(pass)]; };
+	trace_zone_t const zone("render_frame");
+	begin_gpu_frame(profiler);
+
+	/* per view uniform blocks, one per layer. the eyes only differ by a sideways offset,
+	   so the left plane of the left eye and the right plane of the right eye bound both */
+	std::array<frustum_t, max_views> frustums;
+	std::array<glm::mat4, max_views> view_matrices;
+	for (size_t v = 0; v < views.size(); v++)
+	{
+		auto& view = views[v];
+		view_matrices[v] = camera_view(scene.cameras[view.camera]);
+
+		std::array<view_uniforms_t, max_layers> uniforms;
+		for (auto layer = 0; layer < layers; layer++)
+		{
+			auto const eye = eye_view(view_matrices[v], layer, layers, params.eye_separation);
+			auto const view_projection = view.projection * eye;
+			uniforms[layer] = { view.projection, eye, view.view_projection_prev[layer] };
+			view.view_projection_prev[layer] = view_projection;
+
+			auto const frustum = extract_frustum(view_projection);
+			if (layer == 0)
+				frustums[v] = frustum;
+			else
+				frustums[v][1] = frustum[1];
+		}
+		upload_buffer(renderer.ubo_views, GLintptr(v) * renderer.view_stride, sizeof(view_uniforms_t) * layers, uniforms.data());
+	}
+
+	/* cull every object against every view in one pass, then sort the survivors once by shape */
+	begin_trace_zone("cull");
+	auto& draws = renderer.draws;
+	auto& object_uniforms = renderer.object_uniforms;
+	object_uniforms.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		auto& object = objects[i];
+		object_uniforms[i] = { object.model, object.model_prev, GLuint(i) + 1, GLuint(object.except) };
+		object.model_prev = object.model;
+	}
+	cull_objects(objects, frustums.data(), views.size(), draws);
+	upload_buffer(renderer.ssbo_objects, 0, GLsizeiptr(object_uniforms.size() * sizeof(object_uniforms_t)), object_uniforms.data());
+	end_trace_zone();
+
+	/* g-buffer pass */
+	auto const depth_clear_val = 1.0f;
+	glClearNamedFramebufferfv(renderer.fb_gbuffer, GL_COLOR, 0, glm::value_ptr(glm::vec3(0.0f)));
+	glClearNamedFramebufferfv(renderer.fb_gbuffer, GL_COLOR, 1, glm::value_ptr(glm::vec3(0.0f)));
+	glClearNamedFramebufferfv(renderer.fb_gbuffer, GL_COLOR, 2, glm::value_ptr(glm::vec4(0.0f)));
+	glClearNamedFramebufferfv(renderer.fb_gbuffer, GL_COLOR, 3, glm::value_ptr(glm::vec2(0.0f)));
+	glClearNamedFramebufferfv(renderer.fb_gbuffer, GL_DEPTH, 0, &depth_clear_val);
+	if (renderer.object_ids)
+	{
+		glClearNamedFramebufferuiv(renderer.fb_gbuffer, GL_COLOR, 4, &no_object);
+	}
+
+	bind_framebuffer(renderer.fb_gbuffer);
+
+	bind_texture_unit(0, assets.texture_cube_diffuse);
+	bind_texture_unit(1, assets.texture_cube_specular);
+	bind_texture_unit(2, assets.texture_cube_normal);
+
+	auto const overdraw = renderer.overdraw.get();
+	if (overdraw)
+		clear_overdraw(*overdraw);
+
+	bind_program_pipeline(overdraw ? overdraw->pr_g : renderer.pr_g);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, block_objects, renderer.ssbo_objects);
+
+	begin_trace_zone("gbuffer");
+	begin_gpu_pass(profiler, pass_t::gbuffer);
+	for (size_t v = 0; v < views.size() && enabled(pass_t::gbuffer); v++)
+	{
+		auto const& rect = views[v].rect;
+		glViewport(rect.x, rect.y, rect.z, rect.w);
+		glBindBufferRange(GL_UNIFORM_BUFFER, block_view, renderer.ubo_views, GLintptr(v) * renderer.view_stride, sizeof(view_uniforms_t) * layers);
+
+		auto bound_shape = -1;
+		for (auto const& draw : draws)
+		{
+			if (!(draw.view_mask & (1u << v)))
+				continue;
+
+			auto const shape = objects[draw.object].shape;
+			if (int(shape) != bound_shape)
+			{
+				switch (shape)
+				{
+				case shape_t::cube: glBindVertexArray(renderer.vao_cube); break;
+				case shape_t::quad: glBindVertexArray(renderer.vao_quad); break;
+				}
+				bound_shape = int(shape);
+			}
+
+			set_uniform(renderer.vert_shader_g, uniform_object_index, GLuint(draw.object));
+			switch (shape)
+			{
+			case shape_t::cube: draw_triangles_indexed(assets.index_count_cube, GL_UNSIGNED_BYTE, layers); break;
+			case shape_t::quad: draw_triangles_indexed(assets.index_count_quad, GL_UNSIGNED_BYTE, layers); break;
+			}
+		}
+	}
+	end_gpu_pass(profiler);
+	end_trace_zone();
+
+	if (overdraw)
+		reduce_overdraw(*overdraw);
+
+	/* actual shading pass */
+	glClearNamedFramebufferfv(renderer.fb_finalcolor, GL_COLOR, 0, glm::value_ptr(glm::vec3(0.0f)));
+	glClearNamedFramebufferfv(renderer.fb_finalcolor, GL_DEPTH, 0, &depth_clear_val);
+
+	bind_framebuffer(renderer.fb_finalcolor);
+
+	bind_texture_unit(0, renderer.texture_gbuffer_position);
+	bind_texture_unit(1, renderer.texture_gbuffer_normal);
+	bind_texture_unit(2, renderer.texture_gbuffer_albedo);
+	bind_texture_unit(3, renderer.texture_gbuffer_depth);
+	bind_texture_unit(4, assets.texture_skybox);
+	bind_texture_unit(5, params.sky_previous ? params.sky_previous : assets.texture_skybox);
+	set_uniform(renderer.frag_shader, uniform_sky_fade, params.sky_fade);
+
+	bind_program_pipeline(renderer.pr);
+	glBindVertexArray(renderer.vao_empty);
+
+	auto const view_uvs = [screen_width, screen_height](glm::ivec4 const& rect) {
+		return glm::vec4(rect) / glm::vec4(screen_width, screen_height, screen_width, screen_height);
+	};
+
+	begin_trace_zone("shading");
+	begin_gpu_pass(profiler, pass_t::shading);
+	for (size_t v = 0; v < views.size() && enabled(pass_t::shading); v++)
+	{
+		auto const& view = views[v];
+		auto const& camera = scene.cameras[view.camera];
+		auto const uvs = view_uvs(view.rect);
+		glViewport(view.rect.x, view.rect.y, view.rect.z, view.rect.w);
+
+		/* stereo eyes take their camera from the view block */
+		if (layers == 1)
+		{
+			set_uniform(renderer.frag_shader, uniform_cam_pos, camera.position);
+			set_uniform(renderer.vert_shader, uniform_cam_dir, glm::inverse(glm::mat3(view_matrices[v])));
+			set_uniform(renderer.vert_shader, uniform_fov, camera.fov);
+			set_uniform(renderer.vert_shader, uniform_aspect, view.aspect);
+			set_uniform(renderer.vert_shader, uniform_tile, view.tile);
+		}
+		set_uniform(renderer.vert_shader, uniform_uvs_offset, glm::vec2(uvs.x, uvs.y));
+		set_uniform(renderer.vert_shader, uniform_uvs_diff, glm::vec2(uvs.z, uvs.w));
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, block_view, renderer.ubo_views, GLintptr(v) * renderer.view_stride, sizeof(view_uniforms_t) * layers);
+		draw_triangles(6, layers);
+	}
+	end_gpu_pass(profiler);
+	end_trace_zone();
+
+	/* motion blur */
+
+	glClearNamedFramebufferfv(renderer.fb_blur, GL_COLOR, 0, glm::value_ptr(glm::vec3(0.0f)));
+
+	bind_framebuffer(renderer.fb_blur);
+
+	bind_texture_unit(0, renderer.texture_gbuffer_color);
+	bind_texture_unit(1, renderer.texture_gbuffer_velocity);
+
+	bind_program_pipeline(renderer.pr_blur);
+	glBindVertexArray(renderer.vao_empty);
+
+	begin_trace_zone("blur");
+	begin_gpu_pass(profiler, pass_t::blur);
+	set_uniform(renderer.frag_shader_blur, uniform_blur_bias, params.vel_scale);
+	for (auto const& view : views)
+	{
+		/* without blur the shaded image is passed through as is, both targets are rgb8 */
+		if (!enabled(pass_t::blur))
+		{
+			glCopyImageSubData(renderer.texture_gbuffer_color, layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 0, view.rect.x, view.rect.y, 0,
+				renderer.texture_motion_blur, layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 0, view.rect.x, view.rect.y, 0, view.rect.z, view.rect.w, layers);
+			continue;
+		}
+
+		auto const uvs = view_uvs(view.rect);
+		glViewport(view.rect.x, view.rect.y, view.rect.z, view.rect.w);
+
+		set_uniform(renderer.frag_shader_blur, uniform_blur_rect, glm::vec4(uvs.x, uvs.y, uvs.x + uvs.z, uvs.y + uvs.w));
+		set_uniform(renderer.vert_shader_blur, uniform_uvs_offset, glm::vec2(uvs.x, uvs.y));
+		set_uniform(renderer.vert_shader_blur, uniform_uvs_diff, glm::vec2(uvs.z, uvs.w));
+
+		draw_triangles(6, layers);
+	}
+	end_gpu_pass(profiler);
+	end_trace_zone();
+
+	if (overdraw)
+		draw_overdraw_heatmap(*overdraw, renderer.vert_shader_blur, renderer.vao_empty);
+
+	/* eyes side by side */
+	if (layers > 1)
+	{
+		for (auto layer = 0; layer < layers; layer++)
+		{
+			glBlitNamedFramebuffer(renderer.fb_eyes[layer], renderer.fb_output, 0, 0, params.extent.x, params.extent.y, layer * params.extent.x, 0, (layer + 1) * params.extent.x, params.extent.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+	end_gpu_frame(profiler);
+}
+
+/* scale raster, extent is the part of each layer that was rendered */
+void present_frame(renderer_t const& renderer, glm::ivec2 const& extent, GLsizei window_width, GLsizei window_height)
+{
+	glViewport(0, 0, window_width, window_height);
+
+	bind_framebuffer(0);
+	glBlitNamedFramebuffer(renderer.fb_output, 0, 0, 0, extent.x * renderer.layers, extent.y, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+/* performance hud: text and graph quads are written straight into a persistently mapped instance
+   buffer, one region per frame in flight, and drawn over the presented image with one instanced draw.
+   glyphs come from stb_easy_font rasterized into a small atlas at startup, nothing allocates per frame */
+constexpr size_t hud_capacity = 4096;
+constexpr size_t hud_regions = 3;
+constexpr size_t hud_history = 128;
+constexpr GLsizei hud_cell_width = 8;
+constexpr GLsizei hud_cell_height = 10;
+constexpr GLsizei hud_atlas_columns = 16;
+constexpr GLsizei hud_scale = 2;
+constexpr double hud_graph_ms = 1000.0 / 30.0;
+constexpr double hud_budget_ms = 1000.0 / 60.0;
+constexpr uint32_t hud_solid = 255;
+constexpr auto uniform_hud_viewport = 0;
+
+/* matches glyph_t in hud.vert */
+struct hud_glyph_t
+{
+	uint32_t position;
+	uint32_t size;
+	uint32_t glyph;
+	uint32_t color;
+};
+
+struct hud_t
+{
+	GLuint ssbo_glyphs;
+	hud_glyph_t* mapped;
+	std::array<GLsync, hud_regions> fences;
+	size_t region;
+	size_t count;
+
+	GLuint texture_font;
+	GLuint pr, vert_shader, frag_shader;
+
+	std::array<float, hud_history> frame_ms;
+	size_t history_next;
+	std::array<float, pass_count> pass_ms;
+	std::array<pass_totals_t, pass_count> last_totals;
+	bool visible;
+};
+
+std::unique_ptr<hud_t> create_hud()
+{
+	auto hud = std::make_unique<hud_t>();
+	hud->fences = {};
+	hud->region = 0;
+	hud->count = 0;
+	hud->frame_ms = {};
+	hud->history_next = 0;
+	hud->pass_ms = {};
+	hud->last_totals = {};
+	hud->visible = true;
+
+	/* printable ascii, each glyph's segments filled into its own cell */
+	constexpr auto glyph_count = 127 - 32;
+	constexpr auto atlas_width = hud_atlas_columns * hud_cell_width;
+	constexpr auto atlas_height = (glyph_count + hud_atlas_columns - 1) / hud_atlas_columns * hud_cell_height;
+	std::vector<uint8_t> atlas(size_t(atlas_width) * size_t(atlas_height));
+	std::array<float, 16 * 64> quads;
+	for (auto glyph = 0; glyph < glyph_count; glyph++)
+	{
+		char text[] = { char(32 + glyph), 0 };
+		auto const quad_count = stb_easy_font_print(0.0f, 0.0f, text, nullptr, quads.data(), int(sizeof(quads)));
+		auto const cell_x = glyph % hud_atlas_columns * hud_cell_width;
+		auto const cell_y = glyph / hud_atlas_columns * hud_cell_height;
+		for (auto q = 0; q < quad_count; q++)
+		{
+			/* vertices are 16 bytes, the first and the third are opposite corners */
+			auto const x0 = int(quads[q * 16 + 0]), y0 = int(quads[q * 16 + 1]);
+			auto const x1 = int(quads[q * 16 + 8]), y1 = int(quads[q * 16 + 9]);
+			for (auto y = y0; y < std::min(y1, hud_cell_height); y++)
+				for (auto x = x0; x < std::min(x1, hud_cell_width); x++)
+					atlas[size_t(cell_y + y) * atlas_width + size_t(cell_x + x)] = 255;
+		}
+	}
+	hud->texture_font = create_texture_2d(GL_R8, GL_RED, atlas_width, atlas_height, atlas.data(), GL_NEAREST, GL_CLAMP_TO_EDGE);
+
+	GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	auto const size = GLsizeiptr(sizeof(hud_glyph_t) * hud_capacity * hud_regions);
+	glCreateBuffers(1, &hud->ssbo_glyphs);
+	glNamedBufferStorage(hud->ssbo_glyphs, size, nullptr, flags);
+	track_buffer(hud->ssbo_glyphs, size_t(size));
+	hud->mapped = static_cast<hud_glyph_t*>(glMapNamedBufferRange(hud->ssbo_glyphs, 0, size, flags));
+
+	std::tie(hud->pr, hud->vert_shader, hud->frag_shader) = create_program("./shaders/hud.vert", "./shaders/hud.frag");
+	return hud;
+}
+
+void delete_hud(hud_t const& hud)
+{
+	for (auto const fence : hud.fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	glUnmapNamedBuffer(hud.ssbo_glyphs);
+	delete_buffers({ hud.ssbo_glyphs });
+	delete_textures({ hud.texture_font });
+	delete_shader(hud.pr, hud.vert_shader, hud.frag_shader);
+}
+
+inline void hud_rect(hud_t& hud, int x, int y, int width, int height, uint32_t glyph, uint32_t color)
+{
+	if (hud.count == hud_capacity)
+		return;
+	hud.mapped[hud.region * hud_capacity + hud.count++] = { uint32_t(x) | uint32_t(y) << 16, uint32_t(width) | uint32_t(height) << 16, glyph, color };
+}
+
+/* monospaced, the cell is wider than any glyph */
+inline void hud_text(hud_t& hud, int x, int y, char const* text, uint32_t color)
+{
+	for (; *text; text++, x += (hud_cell_width - 1) * hud_scale)
+	{
+		if (*text > 32 && *text < 127)
+			hud_rect(hud, x, y, hud_cell_width * hud_scale, hud_cell_height * hud_scale, uint32_t(*text - 32), color);
+	}
+}
+
+/* colors are packed abgr, the byte order unpackUnorm4x8 reads as rgba */
+constexpr uint32_t hud_white = 0xffffffff;
+constexpr uint32_t hud_background = 0xb0000000;
+constexpr uint32_t hud_green = 0xff40e040;
+constexpr uint32_t hud_yellow = 0xff40e0e0;
+constexpr uint32_t hud_red = 0xff4040e0;
+
+/* draws over the window's framebuffer, call after the final blit */
+void draw_hud(hud_t& hud, double frame_ms, counters_t const& counters, gpu_profiler_t const* profiler, GLuint vao_empty, GLsizei window_width, GLsizei window_height)
+{
+	hud.frame_ms[hud.history_next] = float(frame_ms);
+	hud.history_next = (hud.history_next + 1) % hud_history;
+
+	/* smoothed per frame gpu time of every pass since the last call */
+	if (profiler)
+	{
+		for (size_t pass = 0; pass < pass_count; pass++)
+		{
+			auto const& totals = profiler->totals[pass];
+			auto const& last = hud.last_totals[pass];
+			if (totals.frames > last.frames && totals.time_ns >= last.time_ns)
+				hud.pass_ms[pass] = lerp(hud.pass_ms[pass], float(double(totals.time_ns - last.time_ns) / double(totals.frames - last.frames) / 1e6), 0.1f);
+			hud.last_totals[pass] = totals;
+		}
+	}
+	if (!hud.visible)
+		return;
+
+	/* the region written three frames ago has been drawn by now */
+	auto& fence = hud.fences[hud.region];
+	if (fence)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	hud.count = 0;
+
+	constexpr auto line_height = (hud_cell_height + 2) * hud_scale;
+	constexpr auto graph_width = int(hud_history) * hud_scale;
+	constexpr auto graph_height = 32 * hud_scale;
+	auto const line_count = profiler ? 4 : 3;
+	auto const x = 8, width = std::max(graph_width, 40 * (hud_cell_width - 1) * hud_scale) + 16;
+	auto y = 8;
+	hud_rect(hud, x - 8, y - 8, width, line_count * line_height + graph_height + 24, hud_solid, hud_background);
+
+	std::array<char, 96> line;
+	snprintf(line.data(), line.size(), "frame %6.2f ms %6.1f fps", frame_ms, frame_ms > 0.0 ? 1000.0 / frame_ms : 0.0);
+	hud_text(hud, x, y, line.data(), hud_white);
+	y += line_height;
+	if (profiler)
+	{
+		snprintf(line.data(), line.size(), "gpu %s %.2f %s %.2f %s %.2f ms", pass_names[0], hud.pass_ms[0], pass_names[1], hud.pass_ms[1], pass_names[2], hud.pass_ms[2]);
+		hud_text(hud, x, y, line.data(), hud_white);
+		y += line_height;
+	}
+	auto const binds = counters[size_t(counter_t::pipeline_binds)] + counters[size_t(counter_t::texture_binds)] + counters[size_t(counter_t::framebuffer_binds)];
+	snprintf(line.data(), line.size(), "draws %llu triangles %llu binds %llu", static_cast<unsigned long long>(counters[size_t(counter_t::draws)]),
+		static_cast<unsigned long long>(counters[size_t(counter_t::triangles)]), static_cast<unsigned long long>(binds));
+	hud_text(hud, x, y, line.data(), hud_white);
+	y += line_height;
+	auto const uploaded = counters[size_t(counter_t::buffer_bytes)] + counters[size_t(counter_t::texture_bytes)];
+	snprintf(line.data(), line.size(), "uniforms %llu uploaded %.1f KB", static_cast<unsigned long long>(counters[size_t(counter_t::uniform_sets)]), double(uploaded) / 1024.0);
+	hud_text(hud, x, y, line.data(), hud_white);
+	y += line_height;
+
+	/* frame time graph, oldest on the left, with the 60hz budget as a line */
+	auto const graph_bottom = y + graph_height;
+	for (size_t i = 0; i < hud_history; i++)
+	{
+		auto const ms = double(hud.frame_ms[(hud.history_next + i) % hud_history]);
+		auto const height = std::max(1, int(std::min(ms / hud_graph_ms, 1.0) * graph_height));
+		auto const color = ms <= hud_budget_ms ? hud_green : ms <= hud_graph_ms ? hud_yellow : hud_red;
+		hud_rect(hud, x + int(i) * hud_scale, graph_bottom - height, hud_scale, height, hud_solid, color);
+	}
+	hud_rect(hud, x, graph_bottom - int(hud_budget_ms / hud_graph_ms * graph_height), graph_width, 1, hud_solid, hud_white);
+
+	bind_framebuffer(0);
+	glViewport(0, 0, window_width, window_height);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	bind_program_pipeline(hud.pr);
+	bind_texture_unit(0, hud.texture_font);
+	glBindVertexArray(vao_empty);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, hud.ssbo_glyphs, GLintptr(sizeof(hud_glyph_t) * hud_capacity * hud.region), GLsizeiptr(sizeof(hud_glyph_t) * hud_capacity));
+	set_uniform(hud.vert_shader, uniform_hud_viewport, glm::vec2(window_width, window_height));
+	draw_triangles(6, GLsizei(hud.count));
+
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	hud.region = (hud.region + 1) % hud_regions;
+}
+
+/* runtime sky switching. the next sky decodes on a background thread and uploads a few rows at a time
+   within a per frame budget, then fades in over the current one. the sky it replaced is deleted once a
+   fence placed after its last frame signalled, so a switch never waits on the gpu or the disk */
+constexpr size_t sky_upload_budget = 1 << 20;
+
+struct sky_switch_t
+{
+	float fade_seconds;
+	std::future<std::array<image_t, 6>> decoding;
+
+	/* the upload in progress */
+	std::array<image_t, 6> faces;
+	GLuint next = 0;
+	int face = 0, row = 0;
+
+	/* the fade in progress */
+	GLuint previous = 0;
+	int64_t fade_begin_us = 0;
+
+	std::vector<std::pair<GLuint, GLsync>> retired;
+};
+
+std::unique_ptr<sky_switch_t> create_sky_switch(float fade_seconds = 1.0f)
+{
+	auto sky_switch = std::make_unique<sky_switch_t>();
+	sky_switch->fade_seconds = fade_seconds;
+	return sky_switch;
+}
+
+/* false while the previous switch is still loading or fading */
+bool switch_sky(sky_switch_t& sky_switch, std::string const& sky)
+{
+	if (sky_switch.decoding.valid() || sky_switch.next || sky_switch.previous)
+		return false;
+	sky_switch.decoding = std::async(std::launch::async, [paths = sky_paths(sky)]() {
+		trace_zone_t const zone("decode sky");
+		return load_sky(paths);
+	});
+	return true;
+}
+
+/* once per frame before rendering, on the context thread */
+void update_sky_switch(sky_switch_t& sky_switch, assets_t& assets, frame_params_t& params)
+{
+	sky_switch.retired.erase(std::remove_if(sky_switch.retired.begin(), sky_switch.retired.end(), [](std::pair<GLuint, GLsync> const& sky) {
+		auto const status = glClientWaitSync(sky.second, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			return false;
+		glDeleteSync(sky.second);
+		delete_textures({ sky.first });
+		return true;
+	}), sky_switch.retired.end());
+
+	if (sky_switch.decoding.valid() && sky_switch.decoding.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		try
+		{
+			sky_switch.faces = sky_switch.decoding.get();
+			auto const& face = sky_switch.faces[0];
+			glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &sky_switch.next);
+			glTextureStorage2D(sky_switch.next, 1, face.internal_format, face.width, face.height);
+			track_texture(sky_switch.next, memory_category_t::textures, GL_TEXTURE_CUBE_MAP, face.internal_format, face.width, face.height, 6);
+			sky_switch.face = 0;
+			sky_switch.row = 0;
+		}
+		catch (std::exception const& e)
+		{
+			std::clog << "failed to switch sky: " << e.what() << '\n';
+		}
+	}
+
+	if (sky_switch.next)
+	{
+		trace_zone_t const zone("upload sky");
+		auto budget = sky_upload_budget;
+		while (sky_switch.face < 6 && budget > 0)
+		{
+			auto& face = sky_switch.faces[size_t(sky_switch.face)];
+			auto const row_size = size_t(face.width) * pixel_size(face.format, face.type);
+			auto const rows = std::min(std::max(int(budget / row_size), 1), face.height - sky_switch.row);
+			glTextureSubImage3D(sky_switch.next, 0, 0, sky_switch.row, sky_switch.face, face.width, rows, 1, face.format, face.type, face.levels[0].data() + size_t(sky_switch.row) * row_size);
+			add_counter(counter_t::texture_bytes, size_t(rows) * row_size);
+			budget -= std::min(budget, size_t(rows) * row_size);
+
+			sky_switch.row += rows;
+			if (sky_switch.row == face.height)
+			{
+				face = {};
+				sky_switch.face++;
+				sky_switch.row = 0;
+			}
+		}
+
+		if (sky_switch.face == 6)
+		{
+			sky_switch.previous = assets.texture_skybox;
+			assets.texture_skybox = sky_switch.next;
+			sky_switch.next = 0;
+			sky_switch.fade_begin_us = trace_time_us();
+		}
+	}
+
+	params.sky_previous = sky_switch.previous;
+	params.sky_fade = 1.0f;
+	if (sky_switch.previous)
+	{
+		params.sky_fade = glm::clamp(float(trace_time_us() - sky_switch.fade_begin_us) / (sky_switch.fade_seconds * 1e6f), 0.0f, 1.0f);
+		if (params.sky_fade >= 1.0f)
+		{
+			/* every frame that sampled it was submitted before this fence */
+			sky_switch.retired.emplace_back(sky_switch.previous, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+			sky_switch.previous = 0;
+			params.sky_previous = 0;
+		}
+	}
+}
+
+void delete_sky_switch(sky_switch_t& sky_switch)
+{
+	if (sky_switch.decoding.valid())
+		sky_switch.decoding.wait();
+	for (auto const& sky : sky_switch.retired)
+	{
+		glDeleteSync(sky.second);
+		delete_textures({ sky.first });
+	}
+	delete_textures({ sky_switch.next, sky_switch.previous });
+}
+
+/* runtime tuning commands, applied by the render thread between frames. returns the reply line.
+	pass <gbuffer|shading|blur> <on|off>, resolution <scale>, blur <velocity scale>, fov <degrees>,
+	eye-separation <meters>, trace <frames> <path>, sky <name|panorama path>, status, and every scene command */
+std::string apply_tuning_command(frame_params_t& params, scene_t& scene, renderer_t const& renderer, sky_switch_t* sky_switch, bool resizable, std::string const& command)
+{
+	std::istringstream stream(command);
+	std::string name;
+	stream >> name;
+
+	auto const view_count = int(params.views.size());
+	if (name == "pass")
+	{
+		std::string pass, state;
+		stream >> pass >> state;
+		auto const it = std::find_if(pass_names.begin(), pass_names.end(), [&pass](char const* n) { return pass == n; });
+		if (it == pass_names.end() || (state != "on" && state != "off"))
+			return "error: expected pass <gbuffer|shading|blur> <on|off>";
+		params.passes[size_t(it - pass_names.begin())] = state == "on";
+	}
+	else if (name == "resolution")
+	{
+		auto scale = 0.0f;
+		if (!(stream >> scale) || scale < 0.25f || scale > 1.0f)
+			return "error: expected resolution <0.25..1>";
+		if (!resizable)
+			return "error: the resolution is fixed while capturing, serving frames or measuring overdraw";
+		params.resolution_scale = scale;
+		layout_views(params, scene, renderer, view_count);
+	}
+	else if (name == "blur")
+	{
+		if (!(stream >> params.vel_scale))
+			return "error: expected blur <velocity scale>";
+	}
+	else if (name == "fov")
+	{
+		auto degrees = 0.0f;
+		if (!(stream >> degrees) || degrees <= 0.0f || degrees >= 180.0f)
+			return "error: expected fov <degrees>";
+		for (auto& camera : scene.cameras)
+			camera.fov = glm::radians(degrees);
+		layout_views(params, scene, renderer, view_count);
+	}
+	else if (name == "eye-separation")
+	{
+		if (!(stream >> params.eye_separation))
+			return "error: expected eye-separation <meters>";
+	}
+	else if (name == "sky")
+	{
+		std::string sky;
+		if (!(stream >> sky))
+			return "error: expected sky <name|panorama path>";
+		if (!sky_switch)
+			return "error: skies can not be switched with async assets";
+		if (!switch_sky(*sky_switch, sky))
+			return "error: a sky switch is still in progress";
+	}
+	else if (name == "trace")
+	{
+		auto frames = int64_t(0);
+		std::string path;
+		if (!(stream >> frames >> path))
+			return "error: expected trace <frames> <path>";
+		if (!begin_trace_capture(frames, path))
+			return "error: a trace capture is already running";
+	}
+	else if (name == "status")
+	{
+		auto status = string_format("ok resolution %g blur %g fov %g eye-separation %g", params.resolution_scale, params.vel_scale, glm::degrees(scene.cameras[0].fov), params.eye_separation);
+		for (size_t pass = 0; pass < pass_count; pass++)
+			status += string_format(" %s %s", pass_names[pass], params.passes[pass] ? "on" : "off");
+		return status;
+	}
+	else if (name == "memory")
+	{
+		return "ok " + format_gpu_memory();
+	}
+	else if (name == "memory-budget")
+	{
+		auto mib = 0.0;
+		if (!(stream >> mib) || mib < 0.0)
+			return "error: expected memory-budget <MiB, 0 for none>";
+		set_gpu_memory_budget(size_t(mib * double(1 << 20)));
+	}
+	else if (!apply_scene_command(scene, command))
+	{
+		return "error: unknown command " + name;
+	}
+	return "ok";
+}
+
+/* quality presets, lowest first. the auto benchmark picks the highest one that fits the frame budget */
+struct quality_preset_t
+{
+	char const* name;
+	float resolution_scale;
+	bool blur;
+};
+
+constexpr std::array<quality_preset_t, 3> quality_presets =
+{ {
+	{ "low", 0.5f, false },
+	{ "medium", 0.75f, true },
+	{ "high", 1.0f, true },
+} };
+
+/* share of the frame budget the measured gpu time may take */
+constexpr double quality_headroom = 0.8;
+constexpr int quality_warmup_frames = 20;
+constexpr int quality_measured_frames = 100;
+
+inline size_t find_quality_preset(std::string_view name)
+{
+	for (size_t i = 0; i < quality_presets.size(); i++)
+	{
+		if (name == quality_presets[i].name)
+			return i;
+	}
+	throw std::runtime_error("unknown quality preset " + std::string(name));
+}
+
+void apply_quality_preset(frame_params_t& params, scene_t const& scene, renderer_t const& renderer, quality_preset_t const& preset)
+{
+	params.resolution_scale = preset.resolution_scale;
+	params.passes[size_t(pass_t::blur)] = preset.blur;
+	layout_views(params, scene, renderer, int(params.views.size()));
+}
+
+/* renders every preset offscreen on a copy of the scene and params and returns the index of the highest
+   one whose average gpu frame time fits; the lowest when none does */
+size_t calibrate_quality(renderer_t& renderer, assets_t const& assets, scene_t const& scene, frame_params_t const& params, double budget_ms)
+{
+	auto const owned_profiler = !renderer.profiler;
+	if (owned_profiler)
+		renderer.profiler = create_gpu_profiler();
+	auto& profiler = *renderer.profiler;
+
+	auto chosen = size_t(0);
+	for (size_t i = 0; i < quality_presets.size(); i++)
+	{
+		auto calibration_scene = scene;
+		auto calibration_params = params;
+		apply_quality_preset(calibration_params, calibration_scene, renderer, quality_presets[i]);
+
+		for (auto frame = 0; frame < quality_warmup_frames + quality_measured_frames; frame++)
+		{
+			if (frame == quality_warmup_frames)
+				reset_gpu_profiler(profiler);
+			update_scene(calibration_scene, true);
+			render_frame(renderer, assets, calibration_scene, calibration_params);
+		}
+		glFinish();
+		collect_gpu_profiler(profiler);
+
+		auto gpu_ms = 0.0;
+		for (auto const& totals : profiler.totals)
+		{
+			gpu_ms += totals.frames ? double(totals.time_ns) / double(totals.frames) / 1e6 : 0.0;
+		}
+		std::clog << string_format("quality %s: %.3fms gpu per frame\n", quality_presets[i].name, gpu_ms);
+		if (gpu_ms > budget_ms * quality_headroom)
+			break;
+		chosen = i;
+	}
+
+	reset_gpu_profiler(profiler);
+	if (owned_profiler)
+	{
+		delete_gpu_profiler(profiler);
+		renderer.profiler.reset();
+	}
+	return chosen;
+}
+
+/* one "<preset>\t<gl renderer>" line per machine */
+std::string read_cached_quality(std::string const& path, std::string const& gl_renderer)
+{
+	std::ifstream file(path);
+	for (std::string line; std::getline(file, line);)
+	{
+		auto const separator = line.find('\t');
+		if (separator != std::string::npos && line.substr(separator + 1) == gl_renderer)
+			return line.substr(0, separator);
+	}
+	return {};
+}
+
+void write_cached_quality(std::string const& path, std::string const& gl_renderer, std::string const& preset)
+{
+	std::vector<std::string> lines;
+	{
+		std::ifstream file(path);
+		for (std::string line; std::getline(file, line);)
+		{
+			auto const separator = line.find('\t');
+			if (separator == std::string::npos || line.substr(separator + 1) != gl_renderer)
+				lines.push_back(line);
+		}
+	}
+	lines.push_back(preset + '\t' + gl_renderer);
+
+	std::ofstream file(path, std::ios::trunc);
+	for (auto const& line : lines)
+		file << line << '\n';
+	if (!file)
+		std::clog << "failed to write quality cache " << path << '\n';
+}
+
+/* asynchronous readback: a ring of persistently mapped pixel pack buffers, each copy
+   fenced and handed to a worker thread once the gpu has finished writing it */
+struct readback_result_t
+{
+	void const* data;
+	size_t size;
+	GLsizei width, height;
+	int64_t frame;
+};
+
+using readback_callback_t = std::function<void(readback_result_t const&)>;
+
+struct readback_slot_t
+{
+	GLuint pbo = 0;
+	void* mapped = nullptr;
+	GLsync fence = nullptr;
+	readback_callback_t callback;
+	readback_result_t result = {};
+	std::atomic<bool> busy = false;
+};
+
+struct readback_t
+{
+	std::vector<std::unique_ptr<readback_slot_t>> slots;
+	size_t capacity = 0;
+	size_t next = 0;
+	int64_t frame = 0;
+	std::deque<readback_slot_t*> in_flight;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable signal;
+	/* notified whenever the worker has finished a callback and freed its slot */
+	std::condition_variable released;
+	std::deque<readback_slot_t*> ready;
+	bool quit = false;
+};
+
+std::unique_ptr<readback_t> create_readback(size_t slot_capacity, size_t slot_count = 3)
+{
+	auto readback = std::make_unique<readback_t>();
+	readback->capacity = slot_capacity;
+
+	GLbitfield const flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	for (size_t i = 0; i < slot_count; i++)
+	{
+		auto slot = std::make_unique<readback_slot_t>();
+		glCreateBuffers(1, &slot->pbo);
+		glNamedBufferStorage(slot->pbo, slot_capacity, nullptr, flags);
+		track_buffer(slot->pbo, slot_capacity);
+		slot->mapped = glMapNamedBufferRange(slot->pbo, 0, slot_capacity, flags);
+		readback->slots.push_back(std::move(slot));
+	}
+
+	readback->worker = std::thread([rb = readback.get()]()
+	{
+		while (true)
+		{
+			std::unique_lock<std::mutex> lock(rb->mutex);
+			rb->signal.wait(lock, [rb] { return rb->quit || !rb->ready.empty(); });
+			if (rb->ready.empty())
+				return;
+
+			auto const slot = rb->ready.front();
+			rb->ready.pop_front();
+			lock.unlock();
+
+			slot->callback(slot->result);
+			slot->callback = nullptr;
+			lock.lock();
+			slot->busy.store(false, std::memory_order_release);
+			lock.unlock();
+			rb->released.notify_all();
+		}
+	});
+
+	return readback;
+}
+
+inline readback_slot_t* acquire_readback_slot(readback_t& readback, size_t size)
+{
+	if (size > readback.capacity)
+		throw std::runtime_error("readback region exceeds slot capacity");
+
+	auto& slot = *readback.slots[readback.next];
+	if (slot.busy.load(std::memory_order_acquire))
+		return nullptr;
+
+	readback.next = (readback.next + 1) % readback.slots.size();
+	slot.busy.store(true, std::memory_order_relaxed);
+	return &slot;
+}
+
+inline void submit_readback_slot(readback_t& readback, readback_slot_t& slot, readback_callback_t callback, size_t size, GLsizei width, GLsizei height)
+{
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.callback = std::move(callback);
+	slot.result = readback_result_t{ slot.mapped, size, width, height, readback.frame };
+	readback.in_flight.push_back(&slot);
+}
+
+/* returns false instead of waiting when every slot is still in use */
+bool readback_framebuffer(readback_t& readback, GLuint framebuffer, GLenum attachment, glm::ivec4 const& rect, GLenum format, GLenum type, readback_callback_t callback)
+{
+	auto const size = size_t(rect.z) * size_t(rect.w) * pixel_size(format, type);
+	auto const slot = acquire_readback_slot(readback, size);
+	if (!slot)
+		return false;
+
+	glNamedFramebufferReadBuffer(framebuffer, attachment);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	glReadPixels(rect.x, rect.y, rect.z, rect.w, format, type, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	submit_readback_slot(readback, *slot, std::move(callback), size, rect.z, rect.w);
+	return true;
+}
+
+bool readback_texture(readback_t& readback, GLuint texture, GLint level, glm::ivec4 const& rect, GLenum format, GLenum type, readback_callback_t callback)
+{
+	auto const size = size_t(rect.z) * size_t(rect.w) * pixel_size(format, type);
+	auto const slot = acquire_readback_slot(readback, size);
+	if (!slot)
+		return false;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	glGetTextureSubImage(texture, level, rect.x, rect.y, 0, rect.z, rect.w, 1, format, type, GLsizei(size), nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	submit_readback_slot(readback, *slot, std::move(callback), size, rect.z, rect.w);
+	return true;
+}
+
+bool readback_buffer(readback_t& readback, GLuint buffer, GLintptr offset, size_t size, readback_callback_t callback)
+{
+	auto const slot = acquire_readback_slot(readback, size);
+	if (!slot)
+		return false;
+
+	glCopyNamedBufferSubData(buffer, slot->pbo, offset, 0, GLsizeiptr(size));
+
+	submit_readback_slot(readback, *slot, std::move(callback), size, GLsizei(size), 1);
+	return true;
+}
+
+std::future<std::vector<uint8_t>> readback_framebuffer(readback_t& readback, GLuint framebuffer, GLenum attachment, glm::ivec4 const& rect, GLenum format, GLenum type)
+{
+	auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+	auto future = promise->get_future();
+	auto const queued = readback_framebuffer(readback, framebuffer, attachment, rect, format, type, [promise](readback_result_t const& result)
+	{
+		auto const bytes = static_cast<uint8_t const*>(result.data);
+		promise->set_value(std::vector<uint8_t>(bytes, bytes + result.size));
+	});
+	if (!queued)
+		promise->set_exception(std::make_exception_ptr(std::runtime_error("readback ring is full")));
+	return future;
+}
+
+/* hands the copies the gpu has finished to the worker, waiting up to timeout nanoseconds for the oldest */
+void collect_readbacks(readback_t& readback, GLuint64 timeout = 0)
+{
+	while (!readback.in_flight.empty())
+	{
+		auto const slot = readback.in_flight.front();
+		auto const status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		timeout = 0;
+
+		glDeleteSync(slot->fence);
+		slot->fence = nullptr;
+		readback.in_flight.pop_front();
+		{
+			std::lock_guard<std::mutex> lock(readback.mutex);
+			readback.ready.push_back(slot);
+		}
+		readback.signal.notify_one();
+	}
+}
+
+/* called once per frame on the context thread, never waits on the gpu */
+void update_readback(readback_t& readback)
+{
+	readback.frame++;
+	collect_readbacks(readback);
+}
+
+/* for callers that must not lose a readback: blocks the context thread until the next slot of the ring
+   is free, first on the gpu finishing the oldest copy, then on the worker finishing its callback */
+void wait_readback_slot(readback_t& readback)
+{
+	auto const& slot = *readback.slots[readback.next];
+	while (slot.busy.load(std::memory_order_acquire))
+	{
+		if (std::find(readback.in_flight.begin(), readback.in_flight.end(), &slot) != readback.in_flight.end())
+		{
+			collect_readbacks(readback, GL_TIMEOUT_IGNORED);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(readback.mutex);
+		readback.released.wait(lock, [&slot]() { return !slot.busy.load(std::memory_order_acquire); });
+	}
+}
+
+void delete_readback(readback_t& readback)
+{
+	for (auto const slot : readback.in_flight)
+	{
+		glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(slot->fence);
+		std::lock_guard<std::mutex> lock(readback.mutex);
+		readback.ready.push_back(slot);
+	}
+	readback.in_flight.clear();
+	{
+		std::lock_guard<std::mutex> lock(readback.mutex);
+		readback.quit = true;
+	}
+	readback.signal.notify_one();
+	readback.worker.join();
+
+	for (auto const& slot : readback.slots)
+	{
+		glUnmapNamedBuffer(slot->pbo);
+		delete_buffers({ slot->pbo });
+	}
+}
+
+void print_overdraw_stats(readback_result_t const& result)
+{
+	overdraw_stats_t stats;
+	std::memcpy(&stats, result.data, sizeof(stats));
+
+	auto const lanes = double(stats.fragments) + double(stats.helpers);
+	std::ostringstream report;
+	report << string_format("overdraw: %.2f average, %u max, %.1f%% helper lanes, histogram",
+		double(stats.fragments) / double(std::max(stats.pixels, 1u)), stats.max, lanes > 0.0 ? 100.0 * double(stats.helpers) / lanes : 0.0);
+	for (size_t bin = 0; bin < overdraw_bins; bin++)
+	{
+		report << string_format(bin + 1 == overdraw_bins ? " %zu+:%u" : " %zu:%u", bin, stats.histogram[bin]);
+	}
+	report << '\n';
+	std::clog << report.str();
+}
+
+void write_screenshot(readback_result_t const& result)
+{
+	auto const stride = size_t(result.width) * 4;
+	auto const pixels = static_cast<uint8_t const*>(result.data);
+	std::vector<uint8_t> flipped(result.size);
+	for (GLsizei y = 0; y < result.height; y++)
+	{
+		std::copy_n(pixels + (result.height - 1 - y) * stride, stride, flipped.data() + y * stride);
+	}
+
+	auto const filename = "./screenshot_" + std::to_string(result.frame) + ".png";
+	if (!stbi_write_png(filename.c_str(), result.width, result.height, 4, flipped.data(), int(stride)))
+		std::clog << "failed to write " << filename << '\n';
+	else
+		std::clog << "wrote " << filename << '\n';
+}
+
+/* feedback driven mip streaming: every few frames the gbuffer pass records the finest level each
+   material texture was sampled at, and a streamed texture keeps only the levels from there down.
+   finer levels load from disk on a worker when they come into view, and levels nobody sampled for
+   a while are given back, so the tracked texture memory follows what is visible */
+constexpr auto feedback_interval = 8;
+constexpr auto feedback_slots = 3;
+constexpr auto stream_release_feedbacks = 16;
+constexpr uint32_t feedback_unseen = std::numeric_limits<uint32_t>::max();
+
+struct streamed_texture_t
+{
+	GLuint* owner;
+	std::string path;
+	GLenum internal_format, format;
+	stb_comp_t comp;
+
+	/* the full chain on disk, and the finest level of it that is resident */
+	int width, height, levels;
+	int base;
+
+	std::future<image_t> loading;
+	int loading_base = 0;
+	int unused = 0;
+};
+
+struct texture_streamer_t
+{
+	GLuint ssbo_feedback = 0;
+	std::vector<streamed_texture_t> textures;
+	int64_t frame = 0;
+	bool recording = false;
+
+	/* filled by the readback worker */
+	std::mutex mutex;
+	std::array<uint32_t, feedback_slots> needed;
+	bool pending = false, received = false;
+};
+
+std::unique_ptr<texture_streamer_t> create_texture_streamer()
+{
+	auto streamer = std::make_unique<texture_streamer_t>();
+	glCreateBuffers(1, &streamer->ssbo_feedback);
+	glNamedBufferStorage(streamer->ssbo_feedback, sizeof(uint32_t) * feedback_slots, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	track_buffer(streamer->ssbo_feedback, sizeof(uint32_t) * feedback_slots);
+	return streamer;
+}
+
+/* takes over a loaded texture. slots follow the sampler bindings of the gbuffer pass */
+void stream_texture(texture_streamer_t& streamer, GLuint* owner, std::string const& path, stb_comp_t comp)
+{
+	if (streamer.textures.size() == feedback_slots)
+		throw std::runtime_error("no feedback slot left to stream " + path);
+
+	streamed_texture_t texture;
+	texture.owner = owner;
+	texture.path = path;
+	texture.comp = comp;
+	std::tie(texture.internal_format, texture.format) = texture_format(comp);
+	int c;
+	if (!stbi_info(path.c_str(), &texture.width, &texture.height, &c))
+		throw std::runtime_error("failed to read the header of " + path);
+	texture.levels = int(std::log2(std::max(texture.width, texture.height))) + 1;
+
+	GLint resident_width = 0;
+	glGetTextureLevelParameteriv(*owner, 0, GL_TEXTURE_WIDTH, &resident_width);
+	texture.base = 0;
+	while (texture.base + 1 < texture.levels && std::max(texture.width >> texture.base, 1) > resident_width)
+		texture.base++;
+	streamer.textures.push_back(std::move(texture));
+}
+
+/* the coarsest level kept resident, so a texture coming into view never starts from a few texels */
+inline int coarsest_base(streamed_texture_t const& texture)
+{
+	auto base = 0;
+	while (base + 1 < texture.levels && std::min(texture.width >> (base + 1), texture.height >> (base + 1)) >= min_evicted_size)
+		base++;
+	return base;
+}
+
+/* moves a streamed texture to new storage holding levels base and coarser of the full chain. levels that
+   are already resident are copied on the gpu, finer ones are uploaded from the decoded image */
+void set_resident_base(streamed_texture_t& texture, int base, image_t const* image = nullptr)
+{
+	auto const old = *texture.owner;
+	auto const width = std::max(texture.width >> base, 1), height = std::max(texture.height >> base, 1);
+	auto const levels = texture.levels - base;
+
+	GLuint tex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, levels, texture.internal_format, width, height);
+	track_texture(tex, memory_category_t::textures, GL_TEXTURE_2D, texture.internal_format, width, height, 1, levels);
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (auto level = base; level < texture.levels; level++)
+	{
+		auto const w = std::max(texture.width >> level, 1), h = std::max(texture.height >> level, 1);
+		if (level < texture.base)
+		{
+			auto const& data = image->levels[size_t(level - texture.loading_base)];
+			glTextureSubImage2D(tex, level - base, 0, 0, w, h, texture.format, GL_UNSIGNED_BYTE, data.data());
+			add_counter(counter_t::texture_bytes, data.size());
+		}
+		else
+		{
+			glCopyImageSubData(old, GL_TEXTURE_2D, level - texture.base, 0, 0, 0, tex, GL_TEXTURE_2D, level - base, 0, 0, 0, w, h, 1);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	*texture.owner = tex;
+	delete_textures({ old });
+	texture.base = base;
+	std::clog << string_format("streamed %s to %dx%d: %s\n", texture.path.c_str(), width, height, format_gpu_memory().c_str());
+}
+
+/* finishes loads and acts on the latest feedback. runs before the frame is rendered */
+void update_texture_streamer(texture_streamer_t& streamer)
+{
+	trace_zone_t const zone("stream textures");
+	for (auto& texture : streamer.textures)
+	{
+		if (!texture.loading.valid() || texture.loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+		try
+		{
+			auto const image = texture.loading.get();
+			set_resident_base(texture, texture.loading_base, &image);
+		}
+		catch (std::exception const& e)
+		{
+			std::clog << "failed to stream " << texture.path << ": " << e.what() << '\n';
+		}
+	}
+
+	std::array<uint32_t, feedback_slots> needed;
+	{
+		std::lock_guard<std::mutex> lock(streamer.mutex);
+		if (!streamer.received)
+			return;
+		streamer.received = false;
+		needed = streamer.needed;
+	}
+
+	for (size_t slot = 0; slot < streamer.textures.size(); slot++)
+	{
+		auto& texture = streamer.textures[slot];
+		auto const level = needed[slot] == feedback_unseen ? texture.levels : int(needed[slot]);
+		auto const base = std::min(level, coarsest_base(texture));
+		if (texture.loading.valid())
+			continue;
+
+		if (base < texture.base)
+		{
+			texture.unused = 0;
+			texture.loading_base = base;
+			texture.loading = std::async(std::launch::async, [path = texture.path, comp = texture.comp, base]() {
+				trace_zone_t const zone("decode streamed texture");
+				/* png holds no mips, so the whole image decodes and only the levels asked for are kept */
+				auto image = load_image(path, comp, true);
+				image.levels.erase(image.levels.begin(), image.levels.begin() + base);
+				return image;
+			});
+		}
+		else if (base > texture.base && ++texture.unused >= stream_release_feedbacks)
+		{
+			texture.unused = 0;
+			set_resident_base(texture, base);
+		}
+		else if (base == texture.base)
+		{
+			texture.unused = 0;
+		}
+	}
+}
+
+/* arms the feedback writes of the gbuffer pass on every feedback_interval-th frame */
+void begin_texture_feedback(texture_streamer_t& streamer, GLuint frag_shader_g)
+{
+	if (streamer.frame++ % feedback_interval != 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(streamer.mutex);
+		if (streamer.pending)
+			return;
+	}
+
+	streamer.recording = true;
+
+	glClearNamedBufferData(streamer.ssbo_feedback, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &feedback_unseen);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, block_feedback, streamer.ssbo_feedback);
+	set_uniform(frag_shader_g, uniform_feedback, true);
+	for (size_t slot = 0; slot < streamer.textures.size(); slot++)
+	{
+		auto const& texture = streamer.textures[slot];
+		set_uniform(frag_shader_g, uniform_feedback_sizes + GLint(slot), glm::vec2(texture.width, texture.height));
+	}
+}
+
+/* disarms the writes and reads the levels back, they reach update_texture_streamer a few frames later */
+void end_texture_feedback(texture_streamer_t& streamer, GLuint frag_shader_g, readback_t& readback)
+{
+	if (!streamer.recording)
+		return;
+	streamer.recording = false;
+	set_uniform(frag_shader_g, uniform_feedback, false);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	/* the callback runs on the readback worker, and not before update_readback sees the copy land */
+	auto const queued = readback_buffer(readback, streamer.ssbo_feedback, 0, sizeof(uint32_t) * feedback_slots, [&streamer](readback_result_t const& result) {
+		std::lock_guard<std::mutex> lock(streamer.mutex);
+		std::memcpy(streamer.needed.data(), result.data, sizeof(streamer.needed));
+		streamer.pending = false;
+		streamer.received = true;
+	});
+	std::lock_guard<std::mutex> lock(streamer.mutex);
+	streamer.pending = queued;
+}
+
+/* the textures themselves stay with their owners */
+void delete_texture_streamer(texture_streamer_t& streamer)
+{
+	for (auto& texture : streamer.textures)
+	{
+		if (texture.loading.valid())
+			texture.loading.wait();
+	}
+	delete_buffers({ streamer.ssbo_feedback });
+}
+
+/* object-id picking: reads back a small rect of the id attachment, the result arrives a frame or more later */
+
+bool pick_object(readback_t& readback, GLuint framebuffer, GLenum attachment, glm::ivec2 const& position, glm::ivec2 const& target_size, int radius, std::atomic<uint32_t>& picked)
+{
+	auto const min = glm::max(position - radius, glm::ivec2(0));
+	auto const max = glm::min(position + radius + 1, target_size);
+	if (glm::any(glm::lessThanEqual(max, min)))
+		return false;
+
+	auto const rect = glm::ivec4(min, max - min);
+	return readback_framebuffer(readback, framebuffer, attachment, rect, GL_RED_INTEGER, GL_UNSIGNED_INT, [&picked, rect, position](readback_result_t const& result)
+	{
+		/* nearest covered pixel to the cursor wins */
+		auto const ids = static_cast<uint32_t const*>(result.data);
+		auto best = no_object;
+		auto best_distance = std::numeric_limits<int>::max();
+		for (auto y = 0; y < result.height; y++)
+		{
+			for (auto x = 0; x < result.width; x++)
+			{
+				auto const id = ids[y * result.width + x];
+				auto const d = glm::ivec2(rect.x + x, rect.y + y) - position;
+				auto const distance = d.x * d.x + d.y * d.y;
+				if (id != no_object && distance < best_distance)
+				{
+					best = id;
+					best_distance = distance;
+				}
+			}
+		}
+		picked.store(best, std::memory_order_release);
+	});
+}
+
+/* bounded multi-producer multi-consumer queue, one sequence number per cell */
+template<typename T, size_t N>
+struct bounded_queue_t
+{
+	static_assert((N & (N - 1)) == 0, "queue capacity must be a power of two");
+
+	struct cell_t
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::array<cell_t, N> cells;
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+
+	bounded_queue_t() : head(0), tail(0)
+	{
+		for (size_t i = 0; i < N; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	bool try_push(T const& value)
+	{
+		auto pos = tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& cell = cells[pos & (N - 1)];
+			auto const diff = intptr_t(cell.sequence.load(std::memory_order_acquire)) - intptr_t(pos);
+			if (diff == 0)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value = value;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	bool try_pop(T& value)
+	{
+		auto pos = head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto& cell = cells[pos & (N - 1)];
+			auto const diff = intptr_t(cell.sequence.load(std::memory_order_acquire)) - intptr_t(pos + 1);
+			if (diff == 0)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = cell.value;
+					cell.sequence.store(pos + N, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = head.load(std::memory_order_relaxed);
+		}
+	}
+};
+
+/* frame capture: readback callbacks copy into pooled frames, writer threads encode them */
+enum struct capture_format_t
+{
+	y4m = 0,
+	yuv = 1,
+	png = 2
+};
+
+enum struct capture_policy_t
+{
+	drop = 0,
+	block = 1
+};
+
+struct capture_frame_t
+{
+	std::vector<uint8_t> pixels;
+	GLsizei width, height;
+	int64_t index;
+};
+
+constexpr size_t capture_queue_size = 16;
+
+struct capture_t
+{
+	capture_format_t format;
+	capture_policy_t policy;
+	std::string path;
+	int every;
+
+	std::vector<capture_frame_t> frames;
+	bounded_queue_t<capture_frame_t*, capture_queue_size> free_frames;
+	bounded_queue_t<capture_frame_t*, capture_queue_size> queued_frames;
+	/* the queues themselves never block, waiters sleep on these */
+	std::mutex mutex;
+	std::condition_variable frame_freed, frame_queued;
+	std::vector<std::thread> writers;
+	std::FILE* file = nullptr;
+
+	int64_t next_index = 0;
+	std::atomic<int64_t> written = 0;
+	std::atomic<int64_t> dropped = 0;
+	std::atomic<bool> quit = false;
+};
+
+inline void rgba_to_i420(capture_frame_t const& frame, std::vector<uint8_t>& yuv)
+{
+	auto const w = frame.width & ~1;
+	auto const h = frame.height & ~1;
+	auto const stride = size_t(frame.width) * 4;
+	auto const y_plane = yuv.data();
+	auto const u_plane = y_plane + w * h;
+	auto const v_plane = u_plane + (w / 2) * (h / 2);
+
+	for (auto y = 0; y < h; y += 2)
+	{
+		/* readback rows are bottom-up */
+		uint8_t const* rows[2] = {
+			frame.pixels.data() + (frame.height - 1 - y) * stride,
+			frame.pixels.data() + (frame.height - 2 - y) * stride
+		};
+		for (auto x = 0; x < w; x += 2)
+		{
+			auto r_sum = 0, g_sum = 0, b_sum = 0;
+			for (auto j = 0; j < 2; j++)
+			{
+				for (auto i = 0; i < 2; i++)
+				{
+					auto const p = rows[j] + (x + i) * 4;
+					y_plane[(y + j) * w + x + i] = uint8_t((77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8);
+					r_sum += p[0]; g_sum += p[1]; b_sum += p[2];
+				}
+			}
+			auto const c = (y / 2) * (w / 2) + x / 2;
+			u_plane[c] = uint8_t(((-43 * r_sum - 85 * g_sum + 128 * b_sum) >> 10) + 128);
+			v_plane[c] = uint8_t(((128 * r_sum - 107 * g_sum - 21 * b_sum) >> 10) + 128);
+		}
+	}
+}
+
+/* pushes, then notifies under the mutex the waiter checks its predicate under, so no wakeup is lost */
+inline void push_capture_frame(capture_t& capture, bounded_queue_t<capture_frame_t*, capture_queue_size>& queue, std::condition_variable& pushed, capture_frame_t* frame)
+{
+	queue.try_push(frame);
+	{
+		std::lock_guard<std::mutex> lock(capture.mutex);
+	}
+	pushed.notify_one();
+}
+
+void capture_writer(capture_t& capture)
+{
+	std::vector<uint8_t> yuv;
+	while (true)
+	{
+		capture_frame_t* frame = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(capture.mutex);
+			capture.frame_queued.wait(lock, [&capture, &frame]() {
+				return capture.queued_frames.try_pop(frame) || capture.quit.load(std::memory_order_acquire);
+			});
+		}
+		if (!frame)
+			return;
+
+		if (capture.format == capture_format_t::png)
+		{
+			auto const filename = string_format("%s/frame_%06lld.png", capture.path.c_str(), static_cast<long long>(frame->index));
+			auto const stride = frame->width * 4;
+			auto const last_row = frame->pixels.data() + size_t(frame->height - 1) * stride;
+			if (!stbi_write_png(filename.c_str(), frame->width, frame->height, 4, last_row, -stride))
+				std::clog << "failed to write " << filename << '\n';
+		}
+		else
+		{
+			auto const w = frame->width & ~1;
+			auto const h = frame->height & ~1;
+			yuv.resize(size_t(w) * h * 3 / 2);
+			rgba_to_i420(*frame, yuv);
+			if (capture.format == capture_format_t::y4m)
+				std::fputs("FRAME\n", capture.file);
+			std::fwrite(yuv.data(), 1, yuv.size(), capture.file);
+		}
+
+		capture.written.fetch_add(1, std::memory_order_relaxed);
+		push_capture_frame(capture, capture.free_frames, capture.frame_freed, frame);
+	}
+}
+
+/* fps is the rate frames are presented at, y4m has no timestamps and plays back at fps / every */
+std::unique_ptr<capture_t> create_capture(std::string const& path, capture_policy_t policy, int every, int fps, GLsizei width, GLsizei height, int png_threads = 4)
+{
+	auto capture = std::make_unique<capture_t>();
+	capture->path = path;
+	capture->policy = policy;
+	capture->every = std::max(every, 1);
+
+	auto const extension = std::filesystem::path(path).extension().string();
+	if (extension == ".y4m")		capture->format = capture_format_t::y4m;
+	else if (extension == ".yuv")	capture->format = capture_format_t::yuv;
+	else							capture->format = capture_format_t::png;
+
+	if (capture->format == capture_format_t::png)
+	{
+		std::filesystem::create_directories(path);
+	}
+	else
+	{
+		capture->file = std::fopen(path.c_str(), "wb");
+		if (!capture->file)
+			throw std::runtime_error("failed to open capture file " + path);
+		if (capture->format == capture_format_t::y4m)
+			std::fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n", width & ~1, height & ~1, std::max(fps, 1), capture->every);
+	}
+
+	capture->frames.resize(capture_queue_size);
+	for (auto& frame : capture->frames)
+	{
+		frame.pixels.resize(size_t(width) * size_t(height) * 4);
+		capture->free_frames.try_push(&frame);
+	}
+
+	/* y4m and raw yuv are sequential streams, png frames are independent files */
+	auto const writer_count = capture->format == capture_format_t::png ? std::max(png_threads, 1) : 1;
+	for (auto i = 0; i < writer_count; i++)
+		capture->writers.emplace_back(capture_writer, std::ref(*capture));
+
+	return capture;
+}
+
+/* called on the context thread for every presented frame. the frame to copy into is taken here, so the
+   callback on the shared readback worker never waits on the writers. drop skips the frame when no frame or
+   readback slot is free, block stalls the render loop until both are, and loses nothing */
+void capture_framebuffer(capture_t& capture, readback_t& readback, GLuint framebuffer, glm::ivec4 const& rect, int64_t frame_number)
+{
+	if (frame_number % capture.every != 0)
+		return;
+
+	capture_frame_t* frame = nullptr;
+	if (capture.policy == capture_policy_t::block)
+	{
+		std::unique_lock<std::mutex> lock(capture.mutex);
+		capture.frame_freed.wait(lock, [&capture, &frame]() { return capture.free_frames.try_pop(frame); });
+	}
+	else if (!capture.free_frames.try_pop(frame))
+	{
+		capture.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	auto const copy = [&capture, frame](readback_result_t const& result)
+	{
+		std::copy_n(static_cast<uint8_t const*>(result.data), std::min(result.size, frame->pixels.size()), frame->pixels.data());
+		frame->width = result.width;
+		frame->height = result.height;
+		frame->index = capture.next_index++;
+		push_capture_frame(capture, capture.queued_frames, capture.frame_queued, frame);
+	};
+
+	if (capture.policy == capture_policy_t::block)
+	{
+		while (!readback_framebuffer(readback, framebuffer, GL_COLOR_ATTACHMENT0, rect, GL_RGBA, GL_UNSIGNED_BYTE, copy))
+			wait_readback_slot(readback);
+	}
+	else if (!readback_framebuffer(readback, framebuffer, GL_COLOR_ATTACHMENT0, rect, GL_RGBA, GL_UNSIGNED_BYTE, copy))
+	{
+		push_capture_frame(capture, capture.free_frames, capture.frame_freed, frame);
+		capture.dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/* the readback feeding this capture must be deleted first so no callback is still pending */
+void delete_capture(capture_t& capture)
+{
+	{
+		std::lock_guard<std::mutex> lock(capture.mutex);
+		capture.quit.store(true, std::memory_order_release);
+	}
+	capture.frame_queued.notify_all();
+	for (auto& writer : capture.writers)
+		writer.join();
+	if (capture.file)
+		std::fclose(capture.file);
+
+	std::clog << "capture " << capture.path << ": " << capture.written << " frames written, " << capture.dropped << " dropped\n";
+}
+
+/* tiled offline rendering: tiles are claimed through lock files in a shared job directory,
+   so any number of worker processes on this or other machines can join the same job */
+struct tile_job_t
+{
+	std::string directory;
+	int width, height;
+	int tile_size, overlap;
+	int columns, rows;
+	/* every process renders with the sky of the coordinator */
+	std::string sky;
+};
+
+inline std::string tile_path(tile_job_t const& job, int tile, std::string_view extension)
+{
+	return job.directory + "/tile_" + std::to_string(tile) + std::string(extension);
+}
+
+/* the files a job leaves in its directory, the only ones a new job removes. temp and stale files carry
+   the pid of their process before the extension, tile_<n>.<pid>.tmp */
+inline bool is_tile_job_file(std::string const& name)
+{
+	auto const ends_with = [&name](std::string_view suffix) {
+		return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	return name == "job.txt" || (name.compare(0, 5, "tile_") == 0 && (ends_with(".lock") || ends_with(".stale") || ends_with(".tmp") || ends_with(".raw")));
+}
+
+/* a directory holding anything but an earlier job is refused rather than cleared */
+tile_job_t create_tile_job(std::string const& directory, int width, int height, int tile_size, int overlap, std::string const& sky)
+{
+	if (std::filesystem::exists(directory))
+	{
+		if (!std::filesystem::is_empty(directory) && !std::filesystem::exists(directory + "/job.txt"))
+			throw std::runtime_error(directory + " is not empty and holds no tile job, pick another --tile-job directory");
+		for (auto const& entry : std::filesystem::directory_iterator(directory))
+		{
+			if (is_tile_job_file(entry.path().filename().string()))
+				std::filesystem::remove(entry.path());
+		}
+	}
+	std::filesystem::create_directories(directory);
+
+	std::ofstream file(directory + "/job.txt");
+	file << width << ' ' << height << ' ' << tile_size << ' ' << overlap << '\n' << sky << '\n';
+	file.close();
+
+	return tile_job_t{ directory, width, height, tile_size, overlap, (width + tile_size - 1) / tile_size, (height + tile_size - 1) / tile_size, sky };
+}
+
+tile_job_t open_tile_job(std::string const& directory)
+{
+	auto const description = read_text_file(directory + "/job.txt");
+	std::istringstream stream(description);
+	tile_job_t job{};
+	job.directory = directory;
+	/* the sky has a line of its own, panorama paths may hold spaces */
+	if (!(stream >> job.width >> job.height >> job.tile_size >> job.overlap) || !std::getline(stream >> std::ws, job.sky))
+		throw std::runtime_error("invalid tile job in " + directory);
+	job.columns = (job.width + job.tile_size - 1) / job.tile_size;
+	job.rows = (job.height + job.tile_size - 1) / job.tile_size;
+	return job;
+}
+
+/* a lock nobody has touched for this long belongs to a worker that died, and its tile is claimed again */
+constexpr auto tile_lock_timeout = std::chrono::seconds(30);
+
+/* keeps the lock of a tile still in flight from going stale */
+inline void touch_tile_lock(tile_job_t const& job, int tile)
+{
+	std::error_code error;
+	std::filesystem::last_write_time(tile_path(job, tile, ".lock"), std::filesystem::file_time_type::clock::now(), error);
+}
+
+inline bool file_stale(std::string const& path)
+{
+	std::error_code error;
+	auto const touched = std::filesystem::last_write_time(path, error);
+	return !error && std::filesystem::file_time_type::clock::now() - touched > tile_lock_timeout;
+}
+
+/* names of the files one process writes on its own, so processes that ended up with the same tile never
+   write into each other's file */
+inline std::string process_tile_path(tile_job_t const& job, int tile, std::string_view extension)
+{
+#ifdef _WIN32
+	auto const pid = _getpid();
+#else
+	auto const pid = getpid();
+#endif
+	return tile_path(job, tile, "." + std::to_string(pid) + std::string(extension));
+}
+
+/* exclusive creation of the lock file is the claim, whoever creates it renders the tile. a stale lock
+   is renamed away first. two processes may both have seen it stale, and the slower one then renames
+   the fresh lock of the faster one, so the renamed file is checked again and put back when fresh. the
+   worst case left is a tile rendered twice, each process writes its own temp file */
+bool claim_tile(tile_job_t const& job, int& tile)
+{
+	for (auto i = 0; i < job.columns * job.rows; i++)
+	{
+		auto const path = tile_path(job, i, ".lock");
+		if (file_stale(path) && !std::filesystem::exists(tile_path(job, i, ".raw")))
+		{
+			auto const stale = process_tile_path(job, i, ".stale");
+			if (std::rename(path.c_str(), stale.c_str()) == 0)
+			{
+				if (file_stale(stale))
+				{
+					std::remove(stale.c_str());
+					std::clog << "tile " << i << " was claimed by a worker that stopped, claiming it again\n";
+				}
+				else
+				{
+					std::rename(stale.c_str(), path.c_str());
+				}
+			}
+		}
+
+		auto const lock = std::fopen(path.c_str(), "wx");
+		if (lock)
+		{
+			std::fclose(lock);
+			tile = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool tiles_finished(tile_job_t const& job)
+{
+	for (auto i = 0; i < job.columns * job.rows; i++)
+	{
+		if (!std::filesystem::exists(tile_path(job, i, ".raw")))
+			return false;
+	}
+	return true;
+}
+
+/* image rect of a tile in bottom-up pixel coordinates, without overlap */
+inline glm::ivec4 tile_rect(tile_job_t const& job, int tile)
+{
+	auto const x = (tile % job.columns) * job.tile_size;
+	auto const y = (tile / job.columns) * job.tile_size;
+	return glm::ivec4(x, y, std::min(job.tile_size, job.width - x), std::min(job.tile_size, job.height - y));
+}
+
+/* off-center projection that maps the overlapped tile to the whole viewport */
+inline glm::mat4 tile_projection(glm::mat4 const& projection, tile_job_t const& job, int tile)
+{
+	auto const rect = tile_rect(job, tile);
+	auto const size = glm::vec2(job.width, job.height);
+	auto const ndc_min = 2.0f * (glm::vec2(rect.x, rect.y) - float(job.overlap)) / size - 1.0f;
+	auto const ndc_max = 2.0f * (glm::vec2(rect.x, rect.y) + float(job.tile_size + job.overlap)) / size - 1.0f;
+	auto const scale = 2.0f / (ndc_max - ndc_min);
+	auto const center = (ndc_min + ndc_max) * 0.5f;
+	return glm::scale(glm::vec3(scale, 1.0f)) * glm::translate(glm::vec3(-center, 0.0f)) * projection;
+}
+
+/* offset and scale of the overlapped tile in normalized image coordinates, used for sky rays */
+inline glm::vec4 tile_uv_transform(tile_job_t const& job, int tile)
+{
+	auto const rect = tile_rect(job, tile);
+	auto const size = glm::vec2(job.width, job.height);
+	return glm::vec4((glm::vec2(rect.x, rect.y) - float(job.overlap)) / size, glm::vec2(float(job.tile_size + 2 * job.overlap)) / size);
+}
+
+/* runs on the readback worker, the rename publishes the tile only once it is complete */
+void write_tile(tile_job_t const& job, int tile, readback_result_t const& result)
+{
+	auto const temp = process_tile_path(job, tile, ".tmp");
+	std::ofstream file(temp, std::ios::binary);
+	file.write(static_cast<char const*>(result.data), result.size);
+	file.close();
+	std::filesystem::rename(temp, tile_path(job, tile, ".raw"));
+}
+
+#ifdef _WIN32
+using process_t = intptr_t;
+#else
+using process_t = pid_t;
+#endif
+
+std::vector<process_t> spawn_tile_workers(std::string const& executable, tile_job_t const& job, int count)
+{
+	std::vector<process_t> workers;
+	for (auto i = 0; i < count; i++)
+	{
+#ifdef _WIN32
+		auto const pid = _spawnlp(_P_NOWAIT, executable.c_str(), executable.c_str(), "--tile-worker", job.directory.c_str(), nullptr);
+		if (pid == -1)
+			throw std::runtime_error("failed to spawn tile worker");
+#else
+		char const* args[] = { executable.c_str(), "--tile-worker", job.directory.c_str(), nullptr };
+		pid_t pid = 0;
+		/* the p variant searches PATH like the shell did, argv[0] may be a bare name */
+		if (posix_spawnp(&pid, executable.c_str(), nullptr, nullptr, const_cast<char* const*>(args), environ) != 0)
+			throw std::runtime_error("failed to spawn tile worker");
+#endif
+		workers.push_back(pid);
+	}
+	return workers;
+}
+
+/* drops the workers that have exited and reports the ones that failed. without block only posix
+   can tell, on windows the workers are only waited for at the end */
+void reap_tile_workers(std::vector<process_t>& workers, bool block)
+{
+	workers.erase(std::remove_if(workers.begin(), workers.end(), [block](process_t worker) {
+		auto status = 0;
+#ifdef _WIN32
+		if (!block)
+			return false;
+		auto const failed = _cwait(&status, worker, _WAIT_CHILD) == -1 || status != 0;
+#else
+		auto const result = waitpid(worker, &status, block ? 0 : WNOHANG);
+		if (result == 0)
+			return false;
+		auto const failed = result < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+#endif
+		if (failed)
+			std::clog << "tile worker " << worker << " failed, its tiles are claimed again once their locks go stale\n";
+		return true;
+	}), workers.end());
+}
+
+/* streams the finished tiles out one tile row at a time as binary ppm */
+void stitch_tiles(tile_job_t const& job, std::string const& output)
+{
+	auto const tile_count = job.columns * job.rows;
+	for (auto i = 0; i < tile_count; i++)
+	{
+		auto const rect = tile_rect(job, i);
+		std::error_code error;
+		if (std::filesystem::file_size(tile_path(job, i, ".raw"), error) != uintmax_t(rect.z) * uintmax_t(rect.w) * 4 || error)
+			throw std::runtime_error("tile " + std::to_string(i) + " in " + job.directory + " is missing or does not match the job");
+	}
+
+	std::ofstream file(output, std::ios::binary);
+	file << "P6\n" << job.width << ' ' << job.height << "\n255\n";
+
+	std::vector<std::vector<uint8_t>> tiles(job.columns);
+	std::vector<uint8_t> row(size_t(job.width) * 3);
+	for (auto r = job.rows - 1; r >= 0; r--)
+	{
+		for (auto c = 0; c < job.columns; c++)
+		{
+			auto const tile = r * job.columns + c;
+			std::ifstream tile_file(tile_path(job, tile, ".raw"), std::ios::binary);
+			tiles[c].assign(std::istreambuf_iterator<char>(tile_file), std::istreambuf_iterator<char>());
+		}
+
+		auto const rows_in_tile = tile_rect(job, r * job.columns).w;
+		for (auto y = rows_in_tile - 1; y >= 0; y--)
+		{
+			for (auto c = 0; c < job.columns; c++)
+			{
+				auto const rect = tile_rect(job, r * job.columns + c);
+				auto const src = tiles[c].data() + size_t(y) * rect.z * 4;
+				for (auto x = 0; x < rect.z; x++)
+					std::copy_n(src + x * 4, 3, row.data() + (rect.x + x) * 3);
+			}
+			file.write(reinterpret_cast<char const*>(row.data()), row.size());
+		}
+	}
+	std::clog << "wrote " << output << " (" << job.width << 'x' << job.height << ", " << tile_count << " tiles)\n";
+}
+
+#ifdef __linux__
+/* headless context: surfaceless egl, no window system involved */
+struct headless_context_t
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+};
+
+headless_context_t create_headless_context(EGLContext share = EGL_NO_CONTEXT)
+{
+	headless_context_t headless;
+	auto const get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (get_platform_display)
+		headless.display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (headless.display == EGL_NO_DISPLAY)
+		headless.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (!eglInitialize(headless.display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API))
+		throw std::runtime_error("failed to initialize egl");
+
+	EGLint const config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = nullptr;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(headless.display, config_attribs, &config, 1, &config_count) || config_count == 0)
+		throw std::runtime_error("no egl config for desktop opengl");
+
+	EGLint const context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	headless.context = eglCreateContext(headless.display, config, share, context_attribs);
+	if (headless.context == EGL_NO_CONTEXT)
+		throw std::runtime_error("failed to create an opengl 4.5 egl context");
+	if (!eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless.context))
+		throw std::runtime_error("surfaceless egl contexts are not supported");
+	return headless;
+}
+
+void delete_headless_context(headless_context_t const& headless)
+{
+	eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(headless.display, headless.context);
+}
+
+/* unix domain socket helpers, all sockets are non-blocking */
+int create_unix_listener(std::string const& path)
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+		throw std::runtime_error("socket path too long: " + path);
+	std::copy(path.begin(), path.end(), address.sun_path);
+
+	auto const listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	unlink(path.c_str());
+	if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 8) != 0)
+		throw std::runtime_error("failed to listen on " + path);
+	return listener;
+}
+
+int connect_unix_socket(std::string const& path)
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+		throw std::runtime_error("socket path too long: " + path);
+	std::copy(path.begin(), path.end(), address.sun_path);
+
+	auto const connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (connection < 0 || connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		throw std::runtime_error("failed to connect to " + path);
+	return connection;
+}
+
+/* appends complete lines to lines, returns false once the peer has hung up */
+bool read_lines(int connection, std::string& buffer, std::vector<std::string>& lines)
+{
+	std::array<char, 1024> chunk;
+	while (true)
+	{
+		auto const count = recv(connection, chunk.data(), chunk.size(), MSG_DONTWAIT);
+		if (count == 0)
+			return false;
+		if (count < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+		buffer.append(chunk.data(), size_t(count));
+		for (auto end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n'))
+		{
+			lines.push_back(buffer.substr(0, end));
+			buffer.erase(0, end + 1);
+		}
+	}
+}
+
+bool send_line(int connection, std::string const& line)
+{
+	auto const message = line + '\n';
+	return send(connection, message.data(), message.size(), MSG_NOSIGNAL) == ssize_t(message.size());
+}
+
+/* shared-memory frame ring, single producer (the renderer) and single consumer (the encoder) */
+constexpr uint32_t frame_ring_magic = 0x4c474f4d;
+constexpr size_t frame_ring_slots = 4;
+
+struct frame_ring_slot_t
+{
+	uint64_t frame;
+	uint32_t width, height;
+};
+
+struct frame_ring_t
+{
+	uint32_t magic;
+	uint32_t slot_count;
+	uint32_t width, height;
+	uint64_t slot_size;
+	uint64_t data_offset;
+	std::atomic<uint64_t> written;
+	std::atomic<uint64_t> read;
+	std::atomic<uint64_t> dropped;
+	sem_t ready;
+	std::array<frame_ring_slot_t, frame_ring_slots> slots;
+};
+
+inline uint8_t* frame_ring_data(frame_ring_t* ring, uint64_t sequence)
+{
+	return reinterpret_cast<uint8_t*>(ring) + ring->data_offset + (sequence % ring->slot_count) * ring->slot_size;
+}
+
+struct render_server_client_t
+{
+	int connection = -1;
+	/* the start of a line not yet complete */
+	std::string buffer = {};
+};
+
+struct render_server_t
+{
+	std::string path;
+	int listener = -1;
+	std::vector<render_server_client_t> clients;
+	/* the ring has one read cursor and one semaphore, so only one client gets its memfd. the others
+	   may only send commands */
+	int consumer = -1;
+
+	int memfd = -1;
+	frame_ring_t* ring = nullptr;
+	size_t mapping_size = 0;
+};
+
+std::unique_ptr<render_server_t> create_render_server(std::string const& path, GLsizei width, GLsizei height)
+{
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "frame ring atomics must be address free");
+
+	auto server = std::make_unique<render_server_t>();
+	server->path = path;
+	server->listener = create_unix_listener(path);
+
+	auto const data_offset = (sizeof(frame_ring_t) + 4095) & ~size_t(4095);
+	auto const slot_size = (size_t(width) * size_t(height) * 4 + 4095) & ~size_t(4095);
+	server->mapping_size = data_offset + slot_size * frame_ring_slots;
+
+	server->memfd = memfd_create("modernopengl-frames", MFD_CLOEXEC);
+	if (server->memfd < 0 || ftruncate(server->memfd, server->mapping_size) != 0)
+		throw std::runtime_error("failed to create frame ring");
+	auto const mapping = mmap(nullptr, server->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, server->memfd, 0);
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error("failed to map frame ring");
+
+	auto const ring = new (mapping) frame_ring_t();
+	ring->magic = frame_ring_magic;
+	ring->slot_count = frame_ring_slots;
+	ring->width = width;
+	ring->height = height;
+	ring->slot_size = slot_size;
+	ring->data_offset = data_offset;
+	sem_init(&ring->ready, 1, 0);
+	server->ring = ring;
+
+	std::clog << "render server listening on " << path << '\n';
+	return server;
+}
+
+/* accepts new clients, hands the ring's memfd to the first one without a consumer in place, and collects
+   the command lines of all of them */
+void poll_render_server(render_server_t& server, std::vector<std::string>& commands)
+{
+	for (auto connection = accept4(server.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC); connection >= 0; connection = accept4(server.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC))
+	{
+		if (server.consumer >= 0)
+		{
+			if (send_line(connection, "hello commands"))
+				server.clients.push_back(render_server_client_t{ connection });
+			else
+				close(connection);
+			continue;
+		}
+
+		auto const hello = string_format("hello %u %u %u\n", server.ring->width, server.ring->height, server.ring->slot_count);
+
+		iovec payload = { const_cast<char*>(hello.data()), hello.size() };
+		std::array<char, CMSG_SPACE(sizeof(int))> control = {};
+		msghdr message = {};
+		message.msg_iov = &payload;
+		message.msg_iovlen = 1;
+		message.msg_control = control.data();
+		message.msg_controllen = control.size();
+		auto const header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int));
+		std::memcpy(CMSG_DATA(header), &server.memfd, sizeof(int));
+
+		if (sendmsg(connection, &message, MSG_NOSIGNAL) < 0)
+		{
+			close(connection);
+			continue;
+		}
+		server.consumer = connection;
+		server.clients.push_back(render_server_client_t{ connection });
+	}
+
+	for (auto it = server.clients.begin(); it != server.clients.end();)
+	{
+		if (read_lines(it->connection, it->buffer, commands))
+		{
+			++it;
+			continue;
+		}
+		if (it->connection == server.consumer)
+			server.consumer = -1;
+		close(it->connection);
+		it = server.clients.erase(it);
+	}
+}
+
+/* runs on the readback worker; a full ring drops the frame rather than waiting for the consumer */
+void publish_frame(render_server_t& server, readback_result_t const& result)
+{
+	auto const ring = server.ring;
+	auto const sequence = ring->written.load(std::memory_order_relaxed);
+	if (sequence - ring->read.load(std::memory_order_acquire) >= ring->slot_count)
+	{
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	std::copy_n(static_cast<uint8_t const*>(result.data), std::min<size_t>(result.size, ring->slot_size), frame_ring_data(ring, sequence));
+	ring->slots[sequence % ring->slot_count] = frame_ring_slot_t{ uint64_t(result.frame), uint32_t(result.width), uint32_t(result.height) };
+	ring->written.store(sequence + 1, std::memory_order_release);
+	sem_post(&ring->ready);
+}
+
+void delete_render_server(render_server_t& server)
+{
+	for (auto const& client : server.clients)
+		close(client.connection);
+	close(server.listener);
+	unlink(server.path.c_str());
+
+	sem_destroy(&server.ring->ready);
+	munmap(server.ring, server.mapping_size);
+	close(server.memfd);
+}
+
+/* test client: drives the camera over the socket and consumes frames straight out of the shared ring */
+int run_render_client(std::string const& path, int frame_count, std::string const& snapshot)
+{
+	auto const connection = connect_unix_socket(path);
+
+	std::array<char, 256> hello = {};
+	iovec payload = { hello.data(), hello.size() - 1 };
+	std::array<char, CMSG_SPACE(sizeof(int))> control = {};
+	msghdr message = {};
+	message.msg_iov = &payload;
+	message.msg_iovlen = 1;
+	message.msg_control = control.data();
+	message.msg_controllen = control.size();
+	if (recvmsg(connection, &message, 0) <= 0)
+		throw std::runtime_error("render server did not answer");
+	if (!CMSG_FIRSTHDR(&message))
+		throw std::runtime_error(std::string_view(hello.data()).substr(0, 14) == "hello commands"
+			? "the render server already has a frame consumer, it only takes commands from other clients"
+			: "render server did not send a frame ring");
+
+	auto memfd = -1;
+	std::memcpy(&memfd, CMSG_DATA(CMSG_FIRSTHDR(&message)), sizeof(int));
+	struct stat info = {};
+	fstat(memfd, &info);
+	auto const mapping = mmap(nullptr, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error("failed to map frame ring");
+	auto const ring = static_cast<frame_ring_t*>(mapping);
+	if (ring->magic != frame_ring_magic)
+		throw std::runtime_error("unexpected frame ring layout");
+
+	std::clog << "connected: " << hello.data();
+	ring->read.store(ring->written.load(std::memory_order_acquire), std::memory_order_release);
+
+	auto const start = now<std::chrono::microseconds>();
+	auto received = 0;
+	while (received < frame_count)
+	{
+		send_line(connection, "rotate 0 0.01");
+
+		timespec deadline = {};
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += 2;
+		if (sem_timedwait(&ring->ready, &deadline) != 0)
+		{
+			if (errno == EINTR)
+				continue;
+			std::clog << "timed out waiting for a frame\n";
+			break;
+		}
+
+		auto const sequence = ring->read.load(std::memory_order_relaxed);
+		if (sequence >= ring->written.load(std::memory_order_acquire))
+			continue;
+		auto const slot = ring->slots[sequence % ring->slot_count];
+		auto const pixels = frame_ring_data(ring, sequence);
+		if (received == 0 && !snapshot.empty())
+		{
+			auto const stride = int(slot.width) * 4;
+			stbi_write_png(snapshot.c_str(), slot.width, slot.height, 4, pixels + size_t(slot.height - 1) * stride, -stride);
+		}
+		ring->read.store(sequence + 1, std::memory_order_release);
+		received++;
+	}
+
+	auto const seconds = double(now<std::chrono::microseconds>() - start) / 1e6;
+	std::clog << "received " << received << " frames in " << seconds << "s (" << received / seconds << " fps), " << ring->dropped.load() << " dropped by the server\n";
+
+	munmap(mapping, size_t(info.st_size));
+	close(memfd);
+	close(connection);
+	return received == frame_count ? 0 : 1;
+}
+
+/* serves the metrics over http on a localhost port or a unix socket, from its own thread */
+struct metrics_server_t
+{
+	int listener = -1;
+	std::string path;
+	std::thread thread;
+	std::atomic<bool> quit = false;
+	snapshot_buffer_t<metrics_snapshot_t> snapshots;
+
+	/* render thread side */
+	std::array<float, frame_time_history> frame_ms = {};
+	size_t frame_ms_next = 0;
+	size_t frame_ms_count = 0;
+};
+
+int create_tcp_listener(uint16_t port)
+{
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	auto const listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	auto const reuse = 1;
+	if (listener >= 0)
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 8) != 0)
+		throw std::runtime_error("failed to listen on localhost:" + std::to_string(port));
+	return listener;
+}
+
+inline uint64_t resident_memory_bytes()
+{
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size = 0, resident = 0;
+	statm >> size >> resident;
+	return resident * uint64_t(sysconf(_SC_PAGESIZE));
+}
+
+void serve_metrics(metrics_server_t& server)
+{
+	std::array<char, 1024> buffer;
+	while (!server.quit.load(std::memory_order_acquire))
+	{
+		pollfd descriptor = { server.listener, POLLIN, 0 };
+		if (poll(&descriptor, 1, 100) <= 0)
+			continue;
+		auto const connection = accept4(server.listener, nullptr, nullptr, SOCK_CLOEXEC);
+		if (connection < 0)
+			continue;
+
+		/* whatever was requested, the answer is the metrics */
+		timeval const timeout = { 1, 0 };
+		setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		std::string request;
+		while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+		{
+			auto const received = recv(connection, buffer.data(), buffer.size(), 0);
+			if (received <= 0)
+				break;
+			request.append(buffer.data(), size_t(received));
+		}
+
+		auto body = format_metrics(read_snapshot(server.snapshots));
+		body += "# HELP process_resident_memory_bytes Resident memory size in bytes.\n# TYPE process_resident_memory_bytes gauge\n";
+		body += "process_resident_memory_bytes " + std::to_string(resident_memory_bytes()) + '\n';
+
+		auto const response = string_format("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", body.size()) + body;
+		for (size_t sent = 0; sent < response.size();)
+		{
+			auto const written = send(connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+			if (written <= 0)
+				break;
+			sent += size_t(written);
+		}
+		close(connection);
+	}
+}
+
+/* a port number listens on localhost, anything else is a unix socket path */
+std::unique_ptr<metrics_server_t> create_metrics_server(std::string const& endpoint)
+{
+	auto server = std::make_unique<metrics_server_t>();
+	auto const is_port = !endpoint.empty() && std::all_of(endpoint.begin(), endpoint.end(), [](char c) { return c >= '0' && c <= '9'; });
+	if (is_port)
+	{
+		server->listener = create_tcp_listener(uint16_t(std::stoi(endpoint)));
+	}
+	else
+	{
+		server->listener = create_unix_listener(endpoint);
+		server->path = endpoint;
+	}
+	server->thread = std::thread(serve_metrics, std::ref(*server));
+	std::clog << "serving metrics on " << (is_port ? "http://localhost:" : "") << endpoint << '\n';
+	return server;
+}
+
+/* render thread, once per frame */
+void update_metrics_server(metrics_server_t& server, int64_t frame, double frame_ms, counters_t const& totals, gpu_profiler_t const* profiler, size_t readback_in_flight)
+{
+	server.frame_ms[server.frame_ms_next] = float(frame_ms);
+	server.frame_ms_next = (server.frame_ms_next + 1) % frame_time_history;
+	server.frame_ms_count = std::min(server.frame_ms_count + 1, frame_time_history);
+
+	auto& snapshot = snapshot_back(server.snapshots);
+	snapshot.frame = frame;
+	snapshot.frame_ms = server.frame_ms;
+	snapshot.frame_ms_count = server.frame_ms_count;
+	snapshot.counters = totals;
+	snapshot.gpu_passes = profiler != nullptr;
+	snapshot.passes = profiler ? profiler->totals : std::array<pass_totals_t, pass_count>{};
+	snapshot.readback_in_flight = readback_in_flight;
+	publish_snapshot(server.snapshots);
+}
+
+void delete_metrics_server(metrics_server_t& server)
+{
+	server.quit.store(true, std::memory_order_release);
+	server.thread.join();
+	close(server.listener);
+	if (!server.path.empty())
+		unlink(server.path.c_str());
+}
+
+/* line protocol control socket, every command gets exactly one reply line */
+struct control_server_t
+{
+	std::string path;
+	int listener = -1;
+	std::vector<render_server_client_t> clients;
+};
+
+std::unique_ptr<control_server_t> create_control_server(std::string const& path)
+{
+	auto server = std::make_unique<control_server_t>();
+	server->path = path;
+	server->listener = create_unix_listener(path);
+	std::clog << "control socket listening on " << path << '\n';
+	return server;
+}
+
+void poll_control_server(control_server_t& server, std::function<std::string(std::string const&)> const& handler)
+{
+	for (auto connection = accept4(server.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC); connection >= 0; connection = accept4(server.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC))
+	{
+		server.clients.push_back(render_server_client_t{ connection });
+	}
+
+	std::vector<std::string> commands;
+	for (auto it = server.clients.begin(); it != server.clients.end();)
+	{
+		commands.clear();
+		auto connected = read_lines(it->connection, it->buffer, commands);
+		for (auto const& command : commands)
+		{
+			connected = send_line(it->connection, handler(command)) && connected;
+		}
+		if (connected)
+		{
+			++it;
+			continue;
+		}
+		close(it->connection);
+		it = server.clients.erase(it);
+	}
+}
+
+void delete_control_server(control_server_t& server)
+{
+	for (auto const& client : server.clients)
+		close(client.connection);
+	close(server.listener);
+	unlink(server.path.c_str());
+}
+#endif
+
+/* input recording: a header, then per frame the delta time and the key state entries that changed
+   since the previous frame. the scene steps once per frame, so replaying the frames reproduces it */
+constexpr uint32_t input_magic = 0x494c474d;
+constexpr uint32_t input_version = 1;
+constexpr size_t input_keys = 512;
+
+using key_state_t = std::array<bool, input_keys>;
+
+struct input_state_t
+{
+	key_state_t key = {};
+	key_state_t key_pressed = {};
+	key_state_t key_released = {};
+	float dt = 0.0f;
+};
+
+/* a change is the array in the top bits and the scancode in the low ones */
+inline std::array<key_state_t*, 3> input_arrays(input_state_t& state)
+{
+	return { &state.key, &state.key_pressed, &state.key_released };
+}
+
+struct input_recorder_t
+{
+	std::ofstream file;
+	input_state_t last;
+	std::vector<uint16_t> changes;
+};
+
+struct input_player_t
+{
+	std::ifstream file;
+	input_state_t state;
+	int64_t frames = 0;
+};
+
+std::unique_ptr<input_recorder_t> create_input_recorder(std::string const& path)
+{
+	auto recorder = std::make_unique<input_recorder_t>();
+	recorder->file.open(path, std::ios::binary | std::ios::trunc);
+	if (!recorder->file)
+		throw std::runtime_error("failed to create input recording " + path);
+
+	std::array<uint32_t, 3> const header = { input_magic, input_version, uint32_t(input_keys) };
+	recorder->file.write(reinterpret_cast<char const*>(header.data()), sizeof(header));
+	recorder->changes.reserve(input_keys * 3);
+	return recorder;
+}
+
+void record_input(input_recorder_t& recorder, input_state_t& state)
+{
+	auto& changes = recorder.changes;
+	changes.clear();
+	auto const current = input_arrays(state);
+	auto const last = input_arrays(recorder.last);
+	for (size_t a = 0; a < current.size(); a++)
+	{
+		for (size_t i = 0; i < input_keys; i++)
+		{
+			if ((*current[a])[i] != (*last[a])[i])
+				changes.push_back(uint16_t(a << 10 | i));
+		}
+	}
+	recorder.last = state;
+
+	auto const count = uint16_t(changes.size());
+	recorder.file.write(reinterpret_cast<char const*>(&state.dt), sizeof(state.dt));
+	recorder.file.write(reinterpret_cast<char const*>(&count), sizeof(count));
+	recorder.file.write(reinterpret_cast<char const*>(changes.data()), std::streamsize(changes.size() * sizeof(uint16_t)));
+}
+
+std::unique_ptr<input_player_t> create_input_player(std::string const& path)
+{
+	auto player = std::make_unique<input_player_t>();
+	player->file.open(path, std::ios::binary);
+	std::array<uint32_t, 3> header = {};
+	player->file.read(reinterpret_cast<char*>(header.data()), sizeof(header));
+	if (!player->file || header[0] != input_magic || header[1] != input_version || header[2] != input_keys)
+		throw std::runtime_error("not an input recording: " + path);
+	return player;
+}
+
+/* false once the recording has run out */
+bool replay_input(input_player_t& player, input_state_t& state)
+{
+	auto count = uint16_t(0);
+	auto& file = player.file;
+	file.read(reinterpret_cast<char*>(&player.state.dt), sizeof(player.state.dt));
+	file.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!file)
+		return false;
+
+	auto const arrays = input_arrays(player.state);
+	for (auto c = 0; c < count; c++)
+	{
+		auto change = uint16_t(0);
+		if (!file.read(reinterpret_cast<char*>(&change), sizeof(change)) || (change >> 10) >= arrays.size() || (change & 1023) >= input_keys)
+			throw std::runtime_error("corrupt input recording");
+		auto& value = (*arrays[change >> 10])[change & 1023];
+		value = !value;
+	}
+	state = player.state;
+	player.frames++;
+	return true;
+}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glBlitNamedFramebuffer(fb_blur, 0, 0, 0, viewport_width, viewport_height, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+struct options_t
+{
+	std::string capture_path;
+	capture_policy_t capture_policy = capture_policy_t::drop;
+	int capture_every = 1;
+	/* the rate written into y4m headers, it has to match the present rate (the display refresh under
+	   vsync) for the capture to play back at the right speed */
+	int capture_fps = 60;
+	int capture_threads = 4;
+	bool picking = false;
+	int views = 1;
+	bool stereo = false;
+	int benchmark_frames = 0;
+	std::string metrics_path;
+	std::string metrics_endpoint;
+	std::string control;
+	double hitch_budget_ms = 0.0;
+	std::string hitch_directory = ".";
+	std::string quality;
+	double frame_budget_ms = 1000.0 / 60.0;
+	std::string quality_cache = "./quality.cache";
+	bool hud = false;
+	std::string record_input;
+	std::string replay_input;
+	std::string startup_trace;
+	bool async_assets = false;
+	std::string sky = default_sky;
+	double gpu_memory_budget_mib = 0.0;
+	bool stream_textures = false;
+	bool overdraw = false;
+	float eye_separation = 0.064f;
+
+	glm::ivec2 tiled_size = glm::ivec2(0);
+	int tile_size = 2048;
+	int tile_overlap = 16;
+	int tile_workers = 0;
+	std::string tile_job = "./tiles";
+	std::string tile_output = "./render.ppm";
+	std::string tile_worker;
+
+	std::string server;
+	int server_fps = 60;
+	std::string server_client;
+	int client_frames = 300;
+	std::string client_snapshot;
+
+	bool tiled() const { return tiled_size.x > 0 || !tile_worker.empty(); }
+	int instances = 1;
+	int instance_frames = 1000;
+
+	bool headless() const { return tiled() || !server.empty(); }
+};
 
-		SDL_GL_SwapWindow(window);
+options_t parse_options(int argc, char* argv[])
+{
+	options_t options;
+	for (auto i = 1; i < argc; i++)
+	{
+		std::string_view const arg = argv[i];
+		auto const value = [&]() -> std::string_view {
+			if (i + 1 >= argc)
+				throw std::runtime_error("missing value for " + std::string(arg));
+			return argv[++i];
+		};
+
+		if (arg == "--capture")					options.capture_path = value();
+		else if (arg == "--capture-every")		options.capture_every = std::stoi(std::string(value()));
+		else if (arg == "--capture-fps")		options.capture_fps = std::stoi(std::string(value()));
+		else if (arg == "--capture-threads")	options.capture_threads = std::stoi(std::string(value()));
+		else if (arg == "--picking")			options.picking = true;
+		else if (arg == "--views")				options.views = std::stoi(std::string(value()));
+		else if (arg == "--stereo")				options.stereo = true;
+		else if (arg == "--benchmark")			options.benchmark_frames = std::stoi(std::string(value()));
+		else if (arg == "--overdraw")			options.overdraw = true;
+		else if (arg == "--metrics")			options.metrics_path = value();
+		else if (arg == "--metrics-endpoint")	options.metrics_endpoint = value();
+		else if (arg == "--control")			options.control = value();
+		else if (arg == "--hitch-budget")		options.hitch_budget_ms = std::stod(std::string(value()));
+		else if (arg == "--hitch-directory")	options.hitch_directory = value();
+		else if (arg == "--quality")			options.quality = value();
+		else if (arg == "--frame-budget")		options.frame_budget_ms = std::stod(std::string(value()));
+		else if (arg == "--quality-cache")		options.quality_cache = value();
+		else if (arg == "--hud")				options.hud = true;
+		else if (arg == "--record-input")		options.record_input = value();
+		else if (arg == "--replay-input")		options.replay_input = value();
+		else if (arg == "--startup-trace")		options.startup_trace = value();
+		else if (arg == "--async-assets")		options.async_assets = true;
+		else if (arg == "--sky")				options.sky = value();
+		else if (arg == "--gpu-memory-budget")	options.gpu_memory_budget_mib = std::stod(std::string(value()));
+		else if (arg == "--stream-textures")	options.stream_textures = true;
+		else if (arg == "--eye-separation")		options.eye_separation = std::stof(std::string(value()));
+		else if (arg == "--tile-size")			options.tile_size = std::stoi(std::string(value()));
+		else if (arg == "--tile-overlap")		options.tile_overlap = std::stoi(std::string(value()));
+		else if (arg == "--tile-workers")		options.tile_workers = std::stoi(std::string(value()));
+		else if (arg == "--tile-job")			options.tile_job = value();
+		else if (arg == "--tile-output")		options.tile_output = value();
+		else if (arg == "--tile-worker")		options.tile_worker = value();
+		else if (arg == "--server")				options.server = value();
+		else if (arg == "--server-fps")			options.server_fps = std::stoi(std::string(value()));
+		else if (arg == "--server-client")		options.server_client = value();
+		else if (arg == "--client-frames")		options.client_frames = std::stoi(std::string(value()));
+		else if (arg == "--client-snapshot")	options.client_snapshot = value();
+		else if (arg == "--instances")			options.instances = std::stoi(std::string(value()));
+		else if (arg == "--instance-frames")	options.instance_frames = std::stoi(std::string(value()));
+		else if (arg == "--tiled")
+		{
+			auto const size = std::string(value());
+			auto const separator = size.find('x');
+			if (separator == std::string::npos)
+				throw std::runtime_error("expected --tiled <width>x<height>");
+			options.tiled_size = glm::ivec2(std::stoi(size.substr(0, separator)), std::stoi(size.substr(separator + 1)));
+		}
+		else if (arg == "--capture-policy")
+		{
+			auto const policy = value();
+			if (policy == "drop")			options.capture_policy = capture_policy_t::drop;
+			else if (policy == "block")		options.capture_policy = capture_policy_t::block;
+			else throw std::runtime_error("unknown capture policy " + std::string(policy));
+		}
+		else
+		{
+			throw std::runtime_error("unknown option " + std::string(arg));
+		}
 	}
+	return options;
+}
 
-	delete_items(glDeleteBuffers,
+#ifdef __linux__
+/* one independent viewer: its own context sharing the assets, its own targets and scene, driven by its own thread */
+void run_instance(int index, options_t const& options, assets_t const& assets, EGLContext shared, std::atomic<int64_t>& total_frames)
+{
+	auto const headless = create_headless_context(shared);
+	register_debug_callback();
+
+	constexpr auto width = 1920;
+	constexpr auto height = 1080;
+	auto renderer = create_renderer(assets, width, height, false);
+	auto const readback = create_readback(size_t(width) * size_t(height) * 4);
+	auto const server = options.server.empty() ? nullptr : create_render_server(options.server + "." + std::to_string(index), width, height);
+	std::vector<std::string> commands;
+
+	auto scene = create_scene();
+	frame_params_t params;
+	params.aspect = float(width) / float(height);
+	layout_views(params, scene, renderer, 1);
+
+	auto const start = now<std::chrono::microseconds>();
+	auto next_frame = std::chrono::steady_clock::now();
+	auto frames = int64_t(0);
+	auto quit = false;
+	while (!quit && (server || frames < options.instance_frames))
+	{
+		if (server)
 		{
-		vbo_cube, 
-		ibo_cube,
-		
-		vbo_quad, 
-		ibo_quad,
-		});
-	delete_items(glDeleteTextures,
-		{
-		texture_cube_diffuse, 
-		texture_cube_specular, 
-		texture_cube_normal,
-		
-		texture_gbuffer_position, 
-		texture_gbuffer_albedo, 
-		texture_gbuffer_normal, 
-		texture_gbuffer_depth, 
-		texture_gbuffer_color,
-		
-		texture_skybox,
-		
-		texture_motion_blur, 
-		texture_motion_blur_mask
-		});
-	delete_items(glDeleteProgram, {
-		vert_shader, 
-		frag_shader,
-		
-		vert_shader_g, 
-		frag_shader_g,
-		});
+			commands.clear();
+			poll_render_server(*server, commands);
+			for (auto const& command : commands)
+			{
+				if (command == "quit")
+					quit = true;
+				else if (!apply_scene_command(scene, command))
+					std::clog << "unknown server command: " << command << '\n';
+			}
+		}
+
+		update_scene(scene, true);
+		render_frame(renderer, assets, scene, params);
+
+		if (server)
+		{
+			readback_framebuffer(*readback, renderer.fb_output, GL_COLOR_ATTACHMENT0, glm::ivec4(0, 0, width, height), GL_RGBA, GL_UNSIGNED_BYTE, [&server](readback_result_t const& result) { publish_frame(*server, result); });
+
+			next_frame += std::chrono::microseconds(1000000 / std::max(options.server_fps, 1));
+			std::this_thread::sleep_until(next_frame);
+		}
+		update_readback(*readback);
+		frames++;
+	}
+	glFinish();
+
+	auto const seconds = double(now<std::chrono::microseconds>() - start) / 1e6;
+	std::clog << string_format("instance %d: %lld frames, %.1f fps\n", index, static_cast<long long>(frames), frames / seconds);
+	total_frames.fetch_add(frames, std::memory_order_relaxed);
+
+	delete_readback(*readback);
+	if (server)
+	{
+		delete_render_server(*server);
+	}
+	delete_renderer(renderer);
+	delete_headless_context(headless);
+}
+
+int run_instances(options_t const& options)
+{
+	auto const root = create_headless_context();
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+		throw std::runtime_error("failed to load gl");
+	std::clog << glGetString(GL_VERSION) << '\n';
+	register_debug_callback();
+
+	/* assets must be complete before another context samples them */
+	auto const assets = create_assets(options.sky);
+	glFinish();
+
+	auto const start = now<std::chrono::microseconds>();
+	std::atomic<int64_t> total_frames = 0;
+	std::vector<std::thread> instances;
+	for (auto i = 0; i < options.instances; i++)
+	{
+		instances.emplace_back(run_instance, i, std::cref(options), std::cref(assets), root.context, std::ref(total_frames));
+	}
+	for (auto& instance : instances)
+	{
+		instance.join();
+	}
+
+	auto const seconds = double(now<std::chrono::microseconds>() - start) / 1e6;
+	std::clog << string_format("%d instances: %.1f frames per second in total\n", options.instances, total_frames.load() / seconds);
+
+	delete_assets(assets);
+	delete_headless_context(root);
+	return 0;
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+	auto const startup_begin = trace_time_us();
+	auto const options = parse_options(argc, argv);
+	if (!options.startup_trace.empty())
+		begin_trace_capture(1, options.startup_trace);
+
+#ifdef __linux__
+	if (!options.server_client.empty())
+		return run_render_client(options.server_client, options.client_frames, options.client_snapshot);
+	/* the instances only render the scene, with an optional server each, everything else is a feature of the windowed renderer */
+	if (options.instances > 1 && (!options.capture_path.empty() || options.views != 1 || options.stereo || options.picking || options.overdraw
+		|| options.benchmark_frames > 0 || !options.metrics_path.empty() || !options.metrics_endpoint.empty() || !options.control.empty()
+		|| options.hitch_budget_ms > 0.0 || !options.quality.empty() || options.hud || !options.record_input.empty() || !options.replay_input.empty()
+		|| options.async_assets || options.gpu_memory_budget_mib > 0.0 || options.stream_textures || options.tiled()))
+		throw std::runtime_error("multiple instances can not be combined with capture, views, stereo, picking, overdraw, benchmark, metrics, control, hitch, quality, hud, input, async assets, gpu budget, texture streaming or tiled rendering");
+	if (options.instances > 1)
+		return run_instances(options);
+	auto const headless = options.headless() ? create_headless_context() : headless_context_t{};
+	auto const use_window = headless.context == EGL_NO_CONTEXT;
+#else
+	if (!options.server.empty() || !options.server_client.empty() || options.instances > 1 || !options.metrics_endpoint.empty() || !options.control.empty())
+		throw std::runtime_error("the render server, the metrics endpoint, the control socket and multiple instances need linux");
+	auto const use_window = true;
+#endif
+
+	constexpr auto window_width = 1920;
+	constexpr auto window_height = 1080;
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+	const auto window = use_window ? SDL_CreateWindow("ModernOpenGL\0", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width, window_height, SDL_WINDOW_OPENGL | (options.headless() ? SDL_WINDOW_HIDDEN : 0)) : nullptr;
+	const auto gl_context = use_window ? SDL_GL_CreateContext(window) : nullptr;
+	//SDL_GL_SetSwapInterval(0);
+	auto ev = SDL_Event();
+
+	auto key_count = 0;
+	const auto key_state = SDL_GetKeyboardState(&key_count);
+
+	input_state_t input;
+	auto& key = input.key;
+	auto& key_pressed = input.key_pressed;
+	auto& key_released = input.key_released;
+	auto const input_recorder = options.record_input.empty() ? nullptr : create_input_recorder(options.record_input);
+	auto const input_player = options.replay_input.empty() ? nullptr : create_input_player(options.replay_input);
+
+	/* in tiled mode the "screen" is one overlapped tile, which bounds the vram every process needs */
+	auto const tile_job = options.tile_worker.empty()
+		? (options.tiled() ? create_tile_job(options.tile_job, options.tiled_size.x, options.tiled_size.y, options.tile_size, options.tile_overlap, options.sky) : tile_job_t{})
+		: open_tile_job(options.tile_worker);
+
+	auto const& sky = options.tile_worker.empty() ? options.sky : tile_job.sky;
+
+	auto const[screen_width, screen_height] = [&]()
+	{
+		if (options.tiled())
+			return std::pair<int, int>(tile_job.tile_size + 2 * tile_job.overlap, tile_job.tile_size + 2 * tile_job.overlap);
+		if (options.headless())
+			return std::pair<int, int>(window_width, window_height);
+		SDL_DisplayMode display_mode;
+		SDL_GetCurrentDisplayMode(0, &display_mode);
+		return std::pair<int, int>(display_mode.w, display_mode.h);
+	}();
+
+#ifdef __linux__
+	auto const gl_loaded = use_window ? gladLoadGL() : gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+#else
+	auto const gl_loaded = gladLoadGL();
+#endif
+	if (!gl_loaded)
+	{
+		SDL_GL_DeleteContext(gl_context);
+		SDL_DestroyWindow(window);
+		throw std::runtime_error("failed to load gl");
+	}
+
+	std::clog << glGetString(GL_VERSION) << '\n';
+	register_debug_callback();
+
+	if (options.stereo && (options.tiled() || options.picking || options.overdraw))
+		throw std::runtime_error("stereo can not be combined with tiled rendering, picking or overdraw measurement");
+	if (options.async_assets && options.tiled())
+		throw std::runtime_error("tiled stills need every texture resident, async assets can not be used tiled");
+	if (options.gpu_memory_budget_mib > 0.0 && options.tiled())
+		throw std::runtime_error("tiled stills need every texture at full detail, a gpu memory budget can not be used tiled");
+	if (options.stream_textures && (options.tiled() || options.async_assets))
+		throw std::runtime_error("texture streaming can not be combined with tiled rendering or async assets");
+
+	/* stereo eyes share the screen side by side. assets and renderer load as one graph, so
+	   shader compiles overlap the texture decodes */
+	auto const layers = options.stereo ? 2 : 1;
+	assets_t assets;
+	renderer_t renderer;
+
+	/* with async assets the scene opens on placeholders, and the textures fill in while it already runs */
+	auto const asset_manager = options.async_assets ? create_asset_manager() : nullptr;
+	std::array<asset_handle_t, 4> texture_handles = {};
+	if (asset_manager)
+	{
+		texture_handles = {
+			load_texture_async(*asset_manager, diffuse_texture_path, STBI_rgb, 2.0f),
+			load_texture_async(*asset_manager, specular_texture_path, STBI_grey, 1.0f),
+			load_texture_async(*asset_manager, normal_texture_path, STBI_rgb, 1.0f, placeholder_t::flat_normal),
+			load_sky_async(*asset_manager, sky, 0.0f)
+		};
+		bind_asset_textures(*asset_manager, texture_handles, assets);
+	}
+
+	{
+		trace_zone_t zone("startup");
+		task_graph_t startup;
+		auto const assets_loaded = add_asset_tasks(startup, assets, sky, !asset_manager);
+		add_renderer_tasks(startup, renderer, assets, { assets_loaded }, screen_width / layers, screen_height, options.picking, layers);
+		run_task_graph(startup);
+	}
+	std::clog << string_format("startup took %.1f ms\n", double(trace_time_us() - startup_begin) / 1e3);
+
+	/* streamed material textures keep the levels the feedback asks for */
+	auto const texture_streamer = options.stream_textures ? create_texture_streamer() : nullptr;
+	if (texture_streamer)
+	{
+		stream_texture(*texture_streamer, &assets.texture_cube_diffuse, diffuse_texture_path, STBI_rgb);
+		stream_texture(*texture_streamer, &assets.texture_cube_specular, specular_texture_path, STBI_grey);
+		stream_texture(*texture_streamer, &assets.texture_cube_normal, normal_texture_path, STBI_rgb);
+	}
+
+	/* over budget the shared textures lose their top mips, the async asset manager and the streamer keep the ones they own */
+	set_gpu_memory_budget(size_t(options.gpu_memory_budget_mib * double(1 << 20)));
+	if (!asset_manager && !texture_streamer)
+	{
+		make_texture_evictable(&assets.texture_cube_diffuse);
+		make_texture_evictable(&assets.texture_cube_specular);
+		make_texture_evictable(&assets.texture_cube_normal);
+	}
+	std::clog << "gpu memory: " << format_gpu_memory() << '\n';
+	if (!options.startup_trace.empty())
+		end_trace_frame();
+	auto const viewport_width = renderer.width * renderer.layers;
+	auto const viewport_height = renderer.height;
+
+	if (options.overdraw)
+	{
+		renderer.overdraw = create_overdraw(renderer.vert_shader_g, renderer.vert_shader_blur, renderer.width, renderer.height);
+	}
+
+	/* benchmark: measure a fixed number of frames after a warmup, then report and quit */
+	constexpr auto benchmark_warmup = 60;
+	auto benchmark_start = int64_t(0);
+	auto benchmark_counters = counters_t{};
+	if (options.benchmark_frames > 0 || !options.metrics_endpoint.empty() || options.hitch_budget_ms > 0.0 || !options.control.empty())
+	{
+		renderer.profiler = create_gpu_profiler();
+	}
+	if (options.benchmark_frames > 0)
+	{
+		if (window)
+			SDL_GL_SetSwapInterval(0);
+	}
+
+	/* async readback */
+	auto const readback = create_readback(size_t(viewport_width) * size_t(viewport_height) * 4, options.capture_path.empty() ? 3 : 4);
+	auto const capture = options.capture_path.empty() ? nullptr : create_capture(options.capture_path, options.capture_policy, options.capture_every, options.capture_fps, viewport_width, viewport_height, options.capture_threads);
+#ifdef __linux__
+	auto const server = options.server.empty() ? nullptr : create_render_server(options.server, viewport_width, viewport_height);
+	auto const control = options.control.empty() ? nullptr : create_control_server(options.control);
+	/* captured and served frames are fixed size, so those pin the resolution scale */
+	auto const resizable = !capture && !server && !options.overdraw;
+	std::vector<std::string> server_commands;
+	auto next_server_frame = std::chrono::steady_clock::now();
+#endif
+
+	auto scene = create_scene();
+
+	if (options.tiled() && (options.views != 1 || !options.control.empty()))
+		throw std::runtime_error("split-screen views and the control socket can not be used tiled");
+
+	frame_params_t params;
+	params.aspect = options.tiled() ? float(tile_job.width) / float(tile_job.height) : float(window_width) / float(window_height * layers);
+	layout_views(params, scene, renderer, options.views);
+	params.eye_separation = options.eye_separation;
+	/* stills carry no motion */
+	params.vel_scale = options.tiled() ? 0.0f : 2.0f/*float(fps_sum) / float(60)*/;
+
+	/* quality preset: named, or benchmarked once per gl renderer and cached */
+	if (!options.quality.empty())
+	{
+		if (options.tiled() || capture || !options.server.empty() || options.overdraw)
+			throw std::runtime_error("quality presets change the resolution, which tiled, captured, served and overdraw frames need fixed");
+
+		auto preset = options.quality;
+		if (preset == "auto")
+		{
+			auto const gl_renderer = std::string(reinterpret_cast<char const*>(glGetString(GL_RENDERER)));
+			preset = read_cached_quality(options.quality_cache, gl_renderer);
+			if (preset.empty())
+			{
+				preset = quality_presets[calibrate_quality(renderer, assets, scene, params, options.frame_budget_ms)].name;
+				write_cached_quality(options.quality_cache, gl_renderer, preset);
+			}
+		}
+		apply_quality_preset(params, scene, renderer, quality_presets[find_quality_preset(preset)]);
+		std::clog << "quality " << preset << '\n';
+	}
+	auto const full_projection = params.views[0].projection;
+
+	auto tile_workers = options.tiled() && options.tile_worker.empty() ? spawn_tile_workers(argv[0], tile_job, options.tile_workers) : std::vector<process_t>();
+	auto tile = -1;
+
+	auto t1 = SDL_GetTicks() / 1000.0;
+
+	const auto framesToAverage = 10;
+	auto deltaTimeAverage = 0.0;  // first moment
+	auto frameCounter = 0;
+
+	auto curr_time = now();
+	auto frames = int64_t(0);
+
+	/* startup uploads are not part of any frame */
+	frame_counters_t frame_counters;
+	frame_counters.last = read_counters();
+	auto const metrics = options.metrics_path.empty() ? nullptr : create_metrics_sink(options.metrics_path);
+	/* F1 toggles it */
+	auto const hud = window ? create_hud() : nullptr;
+	if (hud)
+		hud->visible = options.hud;
+	auto const hitch_recorder = options.hitch_budget_ms > 0.0 ? create_hitch_recorder(options.hitch_budget_ms, options.hitch_directory) : nullptr;
+	/* F2 cycles the shipped skies, the async asset manager keeps the sky it loaded */
+	auto const sky_switch = asset_manager ? nullptr : create_sky_switch();
+	auto sky_index = size_t(std::find(shipped_skies.begin(), shipped_skies.end(), sky) - shipped_skies.begin()) % shipped_skies.size();
+#ifdef __linux__
+	auto const metrics_server = options.metrics_endpoint.empty() ? nullptr : create_metrics_server(options.metrics_endpoint);
+#endif
+
+	constexpr auto pick_pending = std::numeric_limits<uint32_t>::max();
+	std::atomic<uint32_t> picked_object = pick_pending;
+	auto mouse_buttons = uint32_t(0);
+	while (ev.type != SDL_QUIT)
+	{
+		auto const frame_start = now<std::chrono::microseconds>();
+		trace_zone_t const frame_zone("frame");
+		const auto t2 = SDL_GetTicks() / 1000.0;
+		input.dt = float(t2 - t1);
+		t1 = t2;
+
+		if (options.tiled())
+		{
+			if (!claim_tile(tile_job, tile))
+			{
+				/* workers quit once nothing is left to claim. the coordinator stays until every tile
+				   has landed, and renders the tiles of workers that died once their locks go stale */
+				if (!options.tile_worker.empty() || tiles_finished(tile_job))
+					break;
+				update_readback(*readback);
+				reap_tile_workers(tile_workers, false);
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				continue;
+			}
+			params.views[0].projection = tile_projection(full_projection, tile_job, tile);
+			params.views[0].tile = tile_uv_transform(tile_job, tile);
+		}
+
+		if (SDL_PollEvent(&ev))
+		{
+			for (int i = 0; i < std::min(key_count, int(input_keys)); i++)
+			{
+				key_pressed[i] = !key[i] && key_state[i];
+				key_released[i] = key[i] && !key_state[i];
+				key[i] = bool(key_state[i]);
+				if (key_pressed[i])
+					record_trace_instant(SDL_GetScancodeName(SDL_Scancode(i)));
+			}
+		}
+
+
+		/* a replayed session drives the keys and the timing in place of the keyboard, and ends the run */
+		if (input_player && !replay_input(*input_player, input))
+		{
+			std::clog << "input replay finished after " << input_player->frames << " frames\n";
+			ev.type = SDL_QUIT;
+		}
+		if (input_recorder)
+			record_input(*input_recorder, input);
+
+		deltaTimeAverage += input.dt;
+		frameCounter++;
+
+		if (window)
+			measure_frames(window, deltaTimeAverage, frameCounter, framesToAverage, frame_counters.frame);
+
+		if (key[SDL_SCANCODE_ESCAPE])
+			ev.type = SDL_QUIT;
+
+#ifdef __linux__
+		if (server)
+		{
+			server_commands.clear();
+			poll_render_server(*server, server_commands);
+			for (auto const& command : server_commands)
+			{
+				if (command == "quit")
+					ev.type = SDL_QUIT;
+				else if (!apply_scene_command(scene, command))
+					std::clog << "unknown server command: " << command << '\n';
+			}
+		}
+		if (control)
+		{
+			poll_control_server(*control, [&](std::string const& command) { return apply_tuning_command(params, scene, renderer, sky_switch.get(), resizable, command); });
+		}
+#endif
+
+		if (window)
+			apply_input(scene, key);
+		if (asset_manager)
+		{
+			update_asset_manager(*asset_manager);
+			bind_asset_textures(*asset_manager, texture_handles, assets);
+		}
+		update_gpu_memory();
+		if (sky_switch)
+		{
+			if (key_pressed[SDL_SCANCODE_F2] && switch_sky(*sky_switch, shipped_skies[(sky_index + 1) % shipped_skies.size()]))
+				sky_index = (sky_index + 1) % shipped_skies.size();
+			update_sky_switch(*sky_switch, assets, params);
+		}
+		if (texture_streamer)
+		{
+			update_texture_streamer(*texture_streamer);
+			begin_texture_feedback(*texture_streamer, renderer.overdraw ? renderer.overdraw->frag_shader_g : renderer.frag_shader_g);
+		}
+		update_scene(scene, !options.tiled());
+		render_frame(renderer, assets, scene, params);
+		if (texture_streamer)
+		{
+			end_texture_feedback(*texture_streamer, renderer.overdraw ? renderer.overdraw->frag_shader_g : renderer.frag_shader_g, *readback);
+		}
+		auto const output_width = params.extent.x * renderer.layers;
+		auto const output_height = params.extent.y;
+
+		if (window)
+		{
+			trace_zone_t const zone("present");
+			present_frame(renderer, params.extent, window_width, window_height);
+		}
+
+		if (options.tiled())
+		{
+			auto const rect = tile_rect(tile_job, tile);
+			auto const inner = glm::ivec4(tile_job.overlap, tile_job.overlap, rect.z, rect.w);
+			while (!readback_framebuffer(*readback, renderer.fb_output, GL_COLOR_ATTACHMENT0, inner, GL_RGBA, GL_UNSIGNED_BYTE, [&tile_job, tile](readback_result_t const& result) { write_tile(tile_job, tile, result); }))
+			{
+				/* offline rendering may wait for the oldest tile to land */
+				touch_tile_lock(tile_job, tile);
+				update_readback(*readback);
+				std::this_thread::yield();
+			}
+			update_readback(*readback);
+			continue;
+		}
+
+		if (hud && key_pressed[SDL_SCANCODE_F1])
+			hud->visible = !hud->visible;
+		if (key_pressed[SDL_SCANCODE_F12])
+		{
+			if (!readback_framebuffer(*readback, renderer.fb_output, GL_COLOR_ATTACHMENT0, glm::ivec4(0, 0, output_width, output_height), GL_RGBA, GL_UNSIGNED_BYTE, write_screenshot))
+				std::clog << "screenshot skipped, readback ring is full\n";
+		}
+		if (options.picking)
+		{
+			auto mouse_x = 0, mouse_y = 0;
+			auto const buttons = SDL_GetMouseState(&mouse_x, &mouse_y);
+			auto const clicked = (buttons & SDL_BUTTON(SDL_BUTTON_LEFT)) && !(mouse_buttons & SDL_BUTTON(SDL_BUTTON_LEFT));
+			mouse_buttons = buttons;
+			if (clicked)
+			{
+				auto const position = glm::ivec2(
+					mouse_x * output_width / window_width,
+					output_height - 1 - mouse_y * output_height / window_height
+				);
+				pick_object(*readback, renderer.fb_gbuffer, GL_COLOR_ATTACHMENT4, position, glm::ivec2(output_width, output_height), 2, picked_object);
+			}
 
-	delete_items(glDeleteProgramPipelines, { pr, pr_g });
-	delete_items(glDeleteVertexArrays, { vao_cube, vao_empty });
-	delete_items(glDeleteFramebuffers, { fb_gbuffer, fb_finalcolor, fb_blur });
+			auto const picked = picked_object.exchange(pick_pending, std::memory_order_acquire);
+			if (picked != pick_pending)
+			{
+				std::clog << "picked object " << (picked == no_object ? std::string("none") : std::to_string(picked - 1)) << '\n';
+			}
+		}
+
+		if (renderer.overdraw && frames % 60 == 0)
+		{
+			readback_buffer(*readback, renderer.overdraw->ssbo_stats, 0, sizeof(overdraw_stats_t), print_overdraw_stats);
+		}
+		if (capture)
+		{
+			capture_framebuffer(*capture, *readback, renderer.fb_output, glm::ivec4(0, 0, viewport_width, viewport_height), frames);
+		}
+		{
+			trace_zone_t const zone("readback");
+			update_readback(*readback);
+		}
+		frames++;
+
+		end_counter_frame(frame_counters);
+		end_trace_frame();
+		auto const frame_ms = double(now<std::chrono::microseconds>() - frame_start) / 1000.0;
+		record_trace_frame(frame_counters.frame, frame_ms);
+		if (hitch_recorder)
+		{
+			update_hitch_recorder(*hitch_recorder, frames, frame_ms);
+		}
+		if (metrics)
+		{
+			write_metrics(*metrics, frame_metrics_t{ frames, frame_ms, frame_counters.frame });
+		}
+#ifdef __linux__
+		if (metrics_server)
+		{
+			update_metrics_server(*metrics_server, frames, frame_ms, frame_counters.last, renderer.profiler.get(), readback->in_flight.size());
+		}
+#endif
+
+		if (options.benchmark_frames > 0)
+		{
+			if (frames == benchmark_warmup)
+			{
+				reset_gpu_profiler(*renderer.profiler);
+				benchmark_start = now<std::chrono::microseconds>();
+				benchmark_counters = frame_counters.last;
+			}
+			else if (frames == benchmark_warmup + options.benchmark_frames)
+			{
+				auto const seconds = double(now<std::chrono::microseconds>() - benchmark_start) / 1e6;
+				for (size_t i = 0; i < counter_count; i++)
+				{
+					benchmark_counters[i] = frame_counters.last[i] - benchmark_counters[i];
+				}
+				glFinish();
+				collect_gpu_profiler(*renderer.profiler);
+				print_benchmark(*renderer.profiler, benchmark_counters, options.benchmark_frames, seconds);
+				ev.type = SDL_QUIT;
+			}
+		}
+
+#ifdef __linux__
+		if (server)
+		{
+			readback_framebuffer(*readback, renderer.fb_output, GL_COLOR_ATTACHMENT0, glm::ivec4(0, 0, viewport_width, viewport_height), GL_RGBA, GL_UNSIGNED_BYTE, [&server](readback_result_t const& result) { publish_frame(*server, result); });
+			update_readback(*readback);
+
+			next_server_frame += std::chrono::microseconds(1000000 / std::max(options.server_fps, 1));
+			std::this_thread::sleep_until(next_server_frame);
+		}
+#endif
 
+		if (hud)
+		{
+			trace_zone_t const zone("hud");
+			draw_hud(*hud, frame_ms, frame_counters.frame, renderer.profiler.get(), renderer.vao_empty, window_width, window_height);
+		}
+		if (window)
+		{
+			trace_zone_t const zone("swap");
+			SDL_GL_SwapWindow(window);
+		}
+	}
+
+	delete_readback(*readback);
+	if (hud)
+	{
+		delete_hud(*hud);
+	}
+	if (hitch_recorder)
+	{
+		delete_hitch_recorder(*hitch_recorder);
+	}
+#ifdef __linux__
+	if (server)
+	{
+		delete_render_server(*server);
+	}
+	if (metrics_server)
+	{
+		delete_metrics_server(*metrics_server);
+	}
+	if (control)
+	{
+		delete_control_server(*control);
+	}
+#endif
+	if (options.tiled() && options.tile_worker.empty())
+	{
+		reap_tile_workers(tile_workers, true);
+		stitch_tiles(tile_job, options.tile_output);
+	}
+	if (capture)
+	{
+		delete_capture(*capture);
+	}
+
+	delete_renderer(renderer);
+	if (sky_switch)
+	{
+		delete_sky_switch(*sky_switch);
+	}
+	if (texture_streamer)
+	{
+		delete_texture_streamer(*texture_streamer);
+	}
+	if (asset_manager)
+	{
+		/* the manager owns the textures */
+		assets.texture_cube_diffuse = assets.texture_cube_specular = assets.texture_cube_normal = assets.texture_skybox = 0;
+		delete_asset_manager(*asset_manager);
+	}
+	delete_assets(assets);
+
+#ifdef __linux__
+	if (!use_window)
+	{
+		delete_headless_context(headless);
+		return 0;
+	}
+#endif
 	SDL_GL_DeleteContext(gl_context);
 	SDL_DestroyWindow(window);
 	return 0;